@@ -0,0 +1,141 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Minimal stand-in for the Arduino core so the sketch and the libraries that
+// only need the core (Ticker) compile on the host. Everything time related
+// is forwarded to the virtual clock in halNative.cpp.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+
+#define LED_BUILTIN 13
+#define SS 53
+#define A0 54
+#define A1 55
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr) (*(const void *const *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+template <typename T>
+T min(T a, T b) { return a < b ? a : b; }
+template <typename T>
+T max(T a, T b) { return a > b ? a : b; }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+// The host has no interrupts; the virtual timers run inside clock reads
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class String
+{
+public:
+  String() {}
+  String(const char *value) : value(value ? value : "") {}
+  String(const __FlashStringHelper *value) : value(reinterpret_cast<const char *>(value)) {}
+  String(char value) : value(1, value) {}
+
+  String &operator+=(char c)
+  {
+    value += c;
+    return *this;
+  }
+
+  String &operator+=(const String &other)
+  {
+    value += other.value;
+    return *this;
+  }
+
+  bool operator==(const String &other) const { return value == other.value; }
+  bool operator!=(const String &other) const { return value != other.value; }
+
+  unsigned int length() const { return value.length(); }
+  const char *c_str() const { return value.c_str(); }
+  long toInt() const { return atol(value.c_str()); }
+  float toFloat() const { return (float)atof(value.c_str()); }
+
+private:
+  std::string value;
+};
+
+class HostSerial
+{
+public:
+  void begin(unsigned long) {}
+  int availableForWrite() { return 64; }
+  void flush() {}
+
+  size_t write(uint8_t c) { return emit("%c", c); }
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    if (muted)
+    {
+      return size;
+    }
+    return fwrite(buffer, 1, size, stdout);
+  }
+
+  size_t print(const char *value) { return emit("%s", value); }
+  size_t print(const __FlashStringHelper *value) { return print(reinterpret_cast<const char *>(value)); }
+  size_t print(const String &value) { return print(value.c_str()); }
+  size_t print(char value) { return emit("%c", value); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC) { return base == HEX ? emit("%lX", value) : emit("%ld", value); }
+  size_t print(unsigned long value, int base = DEC) { return base == HEX ? emit("%lX", value) : emit("%lu", value); }
+  size_t print(double value, int digits = 2) { return emit("%.*f", digits, value); }
+
+  size_t println() { return print("\n"); }
+  template <typename T>
+  size_t println(T value) { return print(value) + println(); }
+  template <typename T>
+  size_t println(T value, int format) { return print(value, format) + println(); }
+
+  // Set by the host runner to keep DEBUG output out of benchmarks
+  bool muted = false;
+
+private:
+  template <typename T>
+  size_t emit(const char *format, T value)
+  {
+    return muted ? 0 : printf(format, value);
+  }
+
+  template <typename T>
+  size_t emit(const char *format, int width, T value)
+  {
+    return muted ? 0 : printf(format, width, value);
+  }
+};
+
+extern HostSerial Serial;
+
+#endif
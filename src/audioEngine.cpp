@@ -0,0 +1,382 @@
+#ifdef ARDUINO
+
+#include "audioEngine.h"
+#include "soundCatalog.h"
+#include "soundCache.h"
+#include "sounds.h"
+#include "config.h"
+
+#define SECTOR_BYTES 512
+#define PCM_VOICES 2
+#define STREAMING_VOICE 0
+#define PWM_TOP 1023
+#define BEEP_AMPLITUDE 64
+
+// Keeps the compiler from moving buffer writes past the flag publishing them
+#define AUDIO_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+extern SdFat sd;
+
+// A voice plays its two buffers in turn. A buffer belongs to the interrupt
+// while its ready flag is set and to the loop() side otherwise. The loop()
+// side only touches the other fields while the voice is inactive. A cached
+// clip is a single buffer pointing into the cache.
+struct PcmVoice
+{
+  const uint8_t *samples[2];
+  uint16_t end[2];
+  volatile boolean ready[2];
+  uint8_t current;
+  uint16_t index;
+  uint8_t fraction;
+  uint16_t step; // source samples per output sample, 8.8 fixed point
+  uint8_t gain;  // Q1.7, SOUND_GAIN_UNITY is 1.0
+  uint8_t priority;
+  volatile boolean sourceDone;
+  volatile boolean active;
+};
+
+// Square wave, the top bit of the phase picks the level. Only changed with
+// interrupts off.
+struct BeepVoice
+{
+  uint16_t phase;
+  uint16_t step;
+  uint16_t samplesLeft;
+};
+
+static PcmVoice voices[PCM_VOICES];
+static BeepVoice beep;
+
+static volatile uint16_t isrMaxCycles;
+static unsigned long requestMicros;
+static volatile boolean awaitingFirstSample;
+static volatile unsigned long startMicros;
+static unsigned long dropped;
+
+// Reader side of the streaming voice, only touched from loop()
+static uint8_t buffers[2][SECTOR_BYTES];
+static uint8_t fillBuffer;
+static boolean contiguous;
+static uint32_t nextSector;
+static uint32_t bytesLeft;
+static FsFile file;
+
+// Called with interrupts off
+static void stopOutput()
+{
+  TIMSK5 = 0;
+  TCCR5A = 0; // hands the pin back to digitalWrite()
+  TCCR5B = 0;
+}
+
+static void startOutput()
+{
+  if (TIMSK5 & _BV(TOIE5))
+  {
+    return;
+  }
+
+  // Fast PWM with ICR5 as TOP: one period, and one overflow, per sample
+  ICR5 = PWM_TOP;
+  OCR5A = (PWM_TOP + 1) / 2;
+  TCNT5 = 0;
+  TCCR5A = _BV(COM5A1) | _BV(WGM51);
+  TCCR5B = _BV(WGM53) | _BV(WGM52) | _BV(CS50);
+  TIMSK5 = _BV(TOIE5);
+}
+
+static inline int16_t nextSample(PcmVoice &voice)
+{
+  if (!voice.active)
+  {
+    return 0;
+  }
+
+  uint8_t buffer = voice.current;
+  if (!voice.ready[buffer])
+  {
+    if (voice.sourceDone)
+    {
+      voice.active = false;
+    }
+    return 0; // underrun: silent until the refill catches up
+  }
+
+  // Gain is Q1.7, so this is a single 8 x 8 bit multiply
+  int16_t sample = ((int8_t)(voice.samples[buffer][voice.index] - 128) * (int16_t)voice.gain) >> 7;
+  uint16_t fraction = voice.fraction + (uint8_t)voice.step;
+  voice.fraction = fraction;
+  voice.index += (voice.step >> 8) + (fraction >> 8);
+  if (voice.index >= voice.end[buffer])
+  {
+    voice.ready[buffer] = false;
+    voice.current = buffer ^ 1;
+    voice.index = 0;
+  }
+  return sample;
+}
+
+ISR(TIMER5_OVF_vect)
+{
+  int16_t mix = nextSample(voices[0]) + nextSample(voices[1]);
+
+  if (beep.samplesLeft)
+  {
+    beep.samplesLeft--;
+    beep.phase += beep.step;
+    mix += (beep.phase & 0x8000) ? BEEP_AMPLITUDE : -BEEP_AMPLITUDE;
+  }
+
+  if (mix > 127)
+  {
+    mix = 127;
+  }
+  else if (mix < -128)
+  {
+    mix = -128;
+  }
+  OCR5A = (uint16_t)(mix + 128) << 2;
+
+  if (awaitingFirstSample)
+  {
+    startMicros = micros() - requestMicros;
+    awaitingFirstSample = false;
+  }
+
+  if (!voices[0].active && !voices[1].active && !beep.samplesLeft)
+  {
+    stopOutput();
+  }
+
+  // The counter restarted at the overflow, so it now holds the cycles spent
+  // since then, interrupt entry included
+  uint16_t cycles = TCNT5;
+  if (cycles > isrMaxCycles)
+  {
+    isrMaxCycles = cycles;
+  }
+}
+
+// Reads the next sector of the streamed clip into buffer; skip bytes at its
+// start are header, not samples
+static boolean fill(uint8_t buffer, uint16_t skip)
+{
+  uint16_t count;
+  if (contiguous)
+  {
+    if (!sd.card()->readSector(nextSector, buffers[buffer]))
+    {
+      return false;
+    }
+    nextSector++;
+    count = SECTOR_BYTES - skip;
+  }
+  else
+  {
+    int read = file.read(buffers[buffer], SECTOR_BYTES);
+    if (read <= 0)
+    {
+      return false;
+    }
+    count = read;
+  }
+
+  if (count > bytesLeft)
+  {
+    count = bytesLeft;
+  }
+  bytesLeft -= count;
+
+  PcmVoice &voice = voices[STREAMING_VOICE];
+  voice.samples[buffer] = buffers[buffer];
+  voice.end[buffer] = skip + count;
+  AUDIO_BARRIER();
+  voice.ready[buffer] = true;
+  return true;
+}
+
+// Opens the clip on the streaming voice and reads its first sector
+static boolean startStream(uint8_t sound, const SoundClip &clip)
+{
+  uint16_t skip = 0;
+  contiguous = clip.flags & SOUND_CLIP_CONTIGUOUS;
+  bytesLeft = clip.dataBytes;
+  if (contiguous)
+  {
+    nextSector = clip.firstSector + clip.dataOffset / SECTOR_BYTES;
+    skip = clip.dataOffset % SECTOR_BYTES;
+  }
+  else if (!soundCatalogOpen(sound, file))
+  {
+    return false;
+  }
+
+  if (!fill(0, skip))
+  {
+    file.close();
+    return false;
+  }
+
+  PcmVoice &voice = voices[STREAMING_VOICE];
+  voice.index = skip;
+  voice.sourceDone = bytesLeft == 0;
+  fillBuffer = 1;
+  return true;
+}
+
+// The voice a clip should take, or -1 when every voice that could play it
+// outranks it. Cached clips prefer the cache only voice so the streaming
+// one stays free.
+static int8_t chooseVoice(boolean cached, uint8_t priority)
+{
+  int8_t chosen = -1;
+  for (int8_t v = cached ? PCM_VOICES - 1 : STREAMING_VOICE; v >= 0; v--)
+  {
+    if (!voices[v].active)
+    {
+      return v;
+    }
+    if (voices[v].priority <= priority && (chosen < 0 || voices[v].priority < voices[chosen].priority))
+    {
+      chosen = v;
+    }
+  }
+  return chosen;
+}
+
+void audioEngineBegin()
+{
+  pinMode(SPEAKER_PIN, OUTPUT);
+}
+
+boolean audioEnginePlay(uint8_t sound)
+{
+  const SoundClip *clip = soundCatalogClip(sound);
+  if (clip == NULL)
+  {
+    return false;
+  }
+
+  uint8_t priority = soundPriority(sound);
+  uint16_t cachedLength;
+  const uint8_t *cached = soundCacheLookup(sound, cachedLength);
+  int8_t v = chooseVoice(cached != NULL, priority);
+  if (v < 0)
+  {
+    dropped++;
+    return false;
+  }
+
+  PcmVoice &voice = voices[v];
+  voice.active = false;
+  AUDIO_BARRIER();
+  if (v == STREAMING_VOICE)
+  {
+    file.close();
+  }
+
+  requestMicros = micros();
+  voice.ready[0] = false;
+  voice.ready[1] = false;
+  voice.current = 0;
+  voice.index = 0;
+  voice.fraction = 0;
+  voice.step = ((uint32_t)clip->sampleRate << 8) / AUDIO_ENGINE_SAMPLE_RATE;
+  voice.gain = clip->gain;
+  voice.priority = priority;
+
+  if (cached != NULL)
+  {
+    voice.samples[0] = cached;
+    voice.end[0] = cachedLength;
+    voice.ready[0] = true;
+    voice.sourceDone = true;
+  }
+  else if (!startStream(sound, *clip))
+  {
+    return false;
+  }
+
+  AUDIO_BARRIER();
+  awaitingFirstSample = true;
+  voice.active = true;
+  startOutput();
+  return true;
+}
+
+void audioEngineBeep(uint16_t frequency, uint16_t durationMillis)
+{
+  uint32_t samples = (uint32_t)durationMillis * AUDIO_ENGINE_SAMPLE_RATE / 1000;
+  uint16_t step = ((uint32_t)frequency << 16) / AUDIO_ENGINE_SAMPLE_RATE;
+
+  uint8_t sreg = SREG;
+  cli();
+  beep.phase = 0;
+  beep.step = step;
+  beep.samplesLeft = samples > 0xFFFF ? 0xFFFF : samples;
+  SREG = sreg;
+
+  startOutput();
+}
+
+void audioEngineStop()
+{
+  uint8_t sreg = SREG;
+  cli();
+  for (uint8_t v = 0; v < PCM_VOICES; v++)
+  {
+    voices[v].active = false;
+  }
+  beep.samplesLeft = 0;
+  stopOutput();
+  SREG = sreg;
+
+  file.close();
+}
+
+void audioEngineUpdate()
+{
+  PcmVoice &voice = voices[STREAMING_VOICE];
+  if (!voice.active)
+  {
+    if (file.isOpen())
+    {
+      file.close();
+    }
+    return;
+  }
+
+  if (voice.sourceDone || voice.ready[fillBuffer])
+  {
+    return;
+  }
+
+  if (fill(fillBuffer, 0))
+  {
+    fillBuffer ^= 1;
+  }
+  else
+  {
+    bytesLeft = 0; // read error: let what is buffered play out
+  }
+
+  if (bytesLeft == 0)
+  {
+    voice.sourceDone = true;
+  }
+}
+
+AudioEngineStats audioEngineStats()
+{
+  AudioEngineStats stats;
+  uint8_t sreg = SREG;
+  cli();
+  stats.dropped = dropped;
+  stats.startMicros = startMicros;
+  stats.isrMaxCycles = isrMaxCycles;
+  SREG = sreg;
+  return stats;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+
+// The only owner of the speaker pin (OC5A). Timer5 runs fast PWM with a
+// 10 bit TOP, so one PWM period is one output sample at 15625 Hz, and its
+// overflow interrupt mixes three voices into that sample:
+//
+//  - voice 0 plays any clip, streaming it from the card or from the cache
+//  - voice 1 plays cached clips only, so a click or a short effect can
+//    sound over an announcement that is streaming
+//  - the beep voice synthesises the bomb beep as a square wave
+//
+// A clip goes to a free voice that can play it, otherwise it preempts the
+// eligible voice with the lowest priority (sounds.h) if that priority is not
+// above its own, otherwise it is dropped. A beep never stops a clip. Clips
+// at other sample rates are stepped through at their own rate, and every
+// clip is scaled by its catalog gain as it is mixed.
+//
+// Streamed clips use two sector buffers filled by audioEngineUpdate() from
+// loop(), so card reads never happen inside the interrupt. A buffer lasts
+// 32 ms at 16 kHz; a longer loop() stall silences the voice until the
+// refill catches up.
+
+#define AUDIO_ENGINE_SAMPLE_RATE (F_CPU / 1024)
+
+struct AudioEngineStats
+{
+  unsigned long dropped;     // clips refused because every voice outranked them
+  unsigned long startMicros; // from the last audioEnginePlay() to its first sample
+  uint16_t isrMaxCycles;     // longest mix, counted from the timer overflow
+};
+
+void audioEngineBegin();
+// Starts the clip right away: a streamed clip has its first sector read
+// before this returns
+boolean audioEnginePlay(uint8_t sound);
+void audioEngineBeep(uint16_t frequency, uint16_t durationMillis);
+void audioEngineStop();
+void audioEngineUpdate();
+AudioEngineStats audioEngineStats();
+
+#endif
+
+#endif
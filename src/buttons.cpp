@@ -0,0 +1,102 @@
+#include "buttons.h"
+#include "config.h"
+#include "ringBuffer.h"
+#include "log.h"
+
+#define DEBOUNCE_MICROS (BUTTON_DEBOUNCE_MILLIS * 1000UL)
+
+struct ButtonState
+{
+  uint8_t reported; // last level handed out as an event
+  uint8_t raw;      // last level seen on the wire
+  boolean locked;   // inside the bounce window that follows a report
+  unsigned long lockedSinceMicros;
+};
+
+static ButtonState states[HAL_BUTTON_COUNT];
+static RingBuffer<ButtonEvent, 8> events;
+
+static unsigned long pollMicros;
+static unsigned long pollMillis;
+
+// Microseconds from atMicros to nowMicros, safe across the micros() wrap
+// every 71 minutes. The Timer0 interrupt can stamp an edge after the poll
+// read the clock; such an edge is 0 old, not 71 minutes. micros() counts in
+// 32 bits on the host too, where unsigned long is wider, so the difference
+// is taken in 32 bits.
+static unsigned long ageMicros(unsigned long nowMicros, unsigned long atMicros)
+{
+  int32_t age = (int32_t)(uint32_t)(nowMicros - atMicros);
+  return age > 0 ? age : 0;
+}
+
+static void report(uint8_t button, uint8_t level, unsigned long atMicros)
+{
+  ButtonState &state = states[button];
+  state.reported = level;
+  state.locked = true;
+  state.lockedSinceMicros = atMicros;
+
+  // Turn the edge timestamp into millis() time through its age
+  ButtonEvent event;
+  event.button = button;
+  event.pressed = level == HIGH;
+  event.atMillis = pollMillis - ageMicros(pollMicros, atMicros) / 1000UL;
+  if (!events.push(event))
+  {
+    LOG_WARN(KEYPAD, LOG_BUTTON_EVENT_DROPPED, button, events.droppedCount());
+  }
+}
+
+// Closes the bounce window if it is over by atMicros, settling on the last
+// level seen during it
+static void settle(uint8_t button, unsigned long atMicros)
+{
+  ButtonState &state = states[button];
+  if (state.locked && ageMicros(atMicros, state.lockedSinceMicros) >= DEBOUNCE_MICROS)
+  {
+    state.locked = false;
+    if (state.raw != state.reported)
+    {
+      report(button, state.raw, state.lockedSinceMicros + DEBOUNCE_MICROS);
+    }
+  }
+}
+
+void buttonsBegin()
+{
+  halButtonsBegin();
+  memset(states, 0, sizeof(states));
+  events.clear();
+}
+
+boolean buttonsPoll(ButtonEvent &event)
+{
+  if (events.pop(event))
+  {
+    return true;
+  }
+
+  pollMicros = halMicros();
+  pollMillis = halMillis();
+
+  ButtonEdge edge;
+  while (halButtonPopEdge(edge))
+  {
+    settle(edge.button, edge.micros);
+
+    ButtonState &state = states[edge.button];
+    state.raw = edge.level;
+    if (!state.locked && edge.level != state.reported)
+    {
+      report(edge.button, edge.level, edge.micros);
+    }
+  }
+
+  for (uint8_t button = 0; button < HAL_BUTTON_COUNT; button++)
+  {
+    settle(button, pollMicros);
+  }
+
+  return events.pop(event);
+}
@@ -0,0 +1,24 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <Arduino.h>
+#include "hal.h"
+
+// Debounced plant/defuse button events built from the timestamped edges
+// the HAL captures in interrupt context. The first edge after a quiet
+// period is reported right away, stamped with the time it happened; edges
+// in the following BUTTON_DEBOUNCE_MILLIS are treated as bounce, after which
+// the last level seen is reconciled with the reported one.
+
+struct ButtonEvent
+{
+  uint8_t button; // HAL_BUTTON_PLANT or HAL_BUTTON_DEFUSE
+  boolean pressed;
+  unsigned long atMillis; // when the edge happened, not when it was read
+};
+
+void buttonsBegin();
+// Returns the next debounced event, if any
+boolean buttonsPoll(ButtonEvent &event);
+
+#endif
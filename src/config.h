@@ -0,0 +1,157 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Feature flags. They can be overridden from build_flags in platformio.ini
+#ifndef DEBUG
+#define DEBUG true
+#endif
+
+// Loop latency histogram, see loopProfiler.h
+#ifndef LOOP_PROFILER
+#define LOOP_PROFILER DEBUG
+#endif
+
+// Binary status frames over Serial every TELEMETRY_INTERVAL_MILLIS, see telemetry.h
+#ifndef TELEMETRY
+#define TELEMETRY false
+#endif
+
+#ifndef TELEMETRY_INTERVAL_MILLIS
+#define TELEMETRY_INTERVAL_MILLIS 500
+#endif
+
+// Compile-time log level of each module, LOG_LEVEL_OFF to LOG_LEVEL_DEBUG,
+// see log.h. The display module logs every LED refresh at LOG_LEVEL_DEBUG.
+#ifndef LOG_LEVEL_SETUP
+#define LOG_LEVEL_SETUP (DEBUG ? LOG_LEVEL_INFO : LOG_LEVEL_OFF)
+#endif
+
+#ifndef LOG_LEVEL_KEYPAD
+#define LOG_LEVEL_KEYPAD (DEBUG ? LOG_LEVEL_INFO : LOG_LEVEL_OFF)
+#endif
+
+#ifndef LOG_LEVEL_GAME
+#define LOG_LEVEL_GAME (DEBUG ? LOG_LEVEL_INFO : LOG_LEVEL_OFF)
+#endif
+
+#ifndef LOG_LEVEL_DISPLAY
+#define LOG_LEVEL_DISPLAY (DEBUG ? LOG_LEVEL_INFO : LOG_LEVEL_OFF)
+#endif
+
+#ifndef LOG_LEVEL_SOUND
+#define LOG_LEVEL_SOUND (DEBUG ? LOG_LEVEL_INFO : LOG_LEVEL_OFF)
+#endif
+
+// The loop profiler report, see loopProfiler.h
+#ifndef LOG_LEVEL_PROFILE
+#define LOG_LEVEL_PROFILE (LOOP_PROFILER ? LOG_LEVEL_INFO : LOG_LEVEL_OFF)
+#endif
+
+// Sleep between loop() iterations when no timer is due, see idleUntilNextEvent()
+#ifndef IDLE_BETWEEN_EVENTS
+#define IDLE_BETWEEN_EVENTS true
+#endif
+
+#ifndef DISPLAY_CONNECTED
+#define DISPLAY_CONNECTED true
+#endif
+
+#ifndef LED_DISPLAY_CONNECTED
+#define LED_DISPLAY_CONNECTED true
+#endif
+
+#ifndef SD_CARD_CONNECTED
+#define SD_CARD_CONNECTED true
+#endif
+
+// RAM reserved for short sound clips, see soundCache.h. Sized for the key
+// click as trimmed in sounds.pak, 1981 bytes; the pack build fails when a
+// clip in CACHED_SOUNDS does not fit. Raising it takes SRAM from the stack,
+// check the free memory logged at setup
+#ifndef SOUND_CACHE_BYTES
+#define SOUND_CACHE_BYTES 2048
+#endif
+
+// Size of the game event log on the SD card, 64 events per sector, see gameLog.h
+#ifndef GAME_LOG_SECTORS
+#define GAME_LOG_SECTORS 256
+#endif
+
+// Record every keypad and button event loop() consumes to the SD card, so a
+// round can be replayed, see inputTrace.h
+#ifndef INPUT_TRACE
+#define INPUT_TRACE false
+#endif
+
+// Feed the inputs of the last boot recorded on the card back to the game
+// instead of reading the keypad and buttons. Needs INPUT_TRACE
+#ifndef INPUT_TRACE_REPLAY
+#define INPUT_TRACE_REPLAY false
+#endif
+
+// Size of the input trace on the SD card, a few bytes per event
+#ifndef INPUT_TRACE_SECTORS
+#define INPUT_TRACE_SECTORS 512
+#endif
+
+// Largest times the setup prompts accept, a bigger number is taken as this.
+// Minutes fill the two LED digits left of the colon, seconds are kept in a
+// byte and carried into minutes on the display
+#define MAX_SETTING_MINUTES 99
+#define MAX_SETTING_SECONDS 255
+
+// Longest an effect output may stay on in one go, a longer pulse is cut
+// short. The relay fires the pyro igniter, see pulseOutput.h
+#define RELAY_MAX_ON_MILLIS 2000
+#define SMOKE_MAX_ON_MILLIS 10000
+#define STROBE_MAX_ON_MILLIS 200
+
+// Every effect output is switched off when loop() has not run for this long
+#define PULSE_OUTPUT_WATCHDOG_MILLIS 500
+
+// Button LED effects, see ledEffects.h
+#define PLANT_LED_BREATHE_MILLIS 2000
+#define DEFUSE_LED_ARMING_BLINK_MILLIS 500
+
+// Edges closer than this after a reported press or release are bounce
+#define BUTTON_DEBOUNCE_MILLIS 20
+
+// Wiring (Arduino Mega 2560)
+#define SPEAKER_PIN 46
+#define LED_SCREEN_CLK_PIN 48
+#define LED_SCREEN_DIO_PIN 49
+
+#define ELECTRIC_EXPLOSION_RELAY_PIN 39
+#define SMOKE_MACHINE_PIN 35
+#define STROBE_PIN 34
+#define DEFUSE_BUTTON_PIN A1
+#define PLANT_BUTTON_PIN A0
+#define DEFUSE_BUTTON_LED_PIN 37
+#define PLANT_BUTTON_LED_PIN 36
+
+#define KEYPAD_ROWS 4
+#define KEYPAD_COLS 3
+// Key labels row by row, as seen from the front of the keypad
+#define KEYPAD_KEYMAP "123456789*0#"
+
+// How often the key matrix is scanned; a change must be seen by two scans
+// in a row before it is reported
+#ifndef KEYPAD_SCAN_MILLIS
+#define KEYPAD_SCAN_MILLIS 10
+#endif
+
+#ifndef KEYPAD_LONG_PRESS_MILLIS
+#define KEYPAD_LONG_PRESS_MILLIS 1000
+#endif
+
+// Held while pressing 4 to 9 in the main menu, saves the last game as that preset
+#define PRESET_SAVE_HOLD_KEY '0'
+
+// A key pressed while exactly one other key has been held at least this
+// long is reported as a chord rather than a press. Shorter overlaps are
+// ordinary rollover from fast typing.
+#ifndef KEYPAD_CHORD_MILLIS
+#define KEYPAD_CHORD_MILLIS 250
+#endif
+
+#endif
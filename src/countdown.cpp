@@ -0,0 +1,38 @@
+#include "countdown.h"
+
+void countdownStart(Countdown &countdown, unsigned long startMillis, uint8_t minutes, uint8_t seconds)
+{
+  while (seconds >= 60)
+  {
+    seconds -= 60;
+    minutes++;
+  }
+
+  countdown.minutes = minutes;
+  countdown.seconds = seconds;
+  countdown.secondsLeft = minutes * 60U + seconds;
+  countdown.end = deadlineAt(startMillis + countdown.secondsLeft * 1000UL);
+  // Less than secondsLeft whole seconds remain as soon as the clock moves on
+  countdown.nextStepMillis = startMillis;
+}
+
+boolean countdownUpdate(Countdown &countdown, unsigned long nowMillis)
+{
+  while (countdown.secondsLeft > 0 && (long)(nowMillis - countdown.nextStepMillis) > 0)
+  {
+    countdown.secondsLeft--;
+    countdown.nextStepMillis += 1000;
+
+    if (countdown.seconds > 0)
+    {
+      countdown.seconds--;
+    }
+    else
+    {
+      countdown.seconds = 59;
+      countdown.minutes--;
+    }
+  }
+
+  return countdown.secondsLeft > 0;
+}
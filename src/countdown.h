@@ -0,0 +1,69 @@
+#ifndef COUNTDOWN_H
+#define COUNTDOWN_H
+
+#include <Arduino.h>
+
+// A point in time on the millis() clock. Compared through the signed
+// difference with now, so it stays correct across the 49.7 day wrap as long
+// as the deadline is less than 24.8 days away, and a late check sees a
+// negative time left instead of a huge unsigned one.
+struct Deadline
+{
+  unsigned long atMillis;
+};
+
+inline Deadline deadlineAt(unsigned long atMillis)
+{
+  Deadline deadline = {atMillis};
+  return deadline;
+}
+
+// Negative once the deadline has passed
+inline long deadlineMillisLeft(const Deadline &deadline, unsigned long nowMillis)
+{
+  return (long)(deadline.atMillis - nowMillis);
+}
+
+inline boolean deadlinePassed(const Deadline &deadline, unsigned long nowMillis)
+{
+  return deadlineMillisLeft(deadline, nowMillis) <= 0;
+}
+
+// Minutes and seconds left to a deadline, as the LED display shows them:
+// whole seconds, rounded down. countdownUpdate() runs from the 1 s timers and
+// steps the counters down one second at a time, catching up against the
+// deadline when a tick comes late, so the per tick path has no division.
+struct Countdown
+{
+  Deadline end;
+  unsigned long nextStepMillis; // when secondsLeft drops by one
+  uint16_t secondsLeft;
+  uint8_t minutes;
+  uint8_t seconds;
+};
+
+// How often the bomb beeps, and its defuse LED flashes, with secondsLeft on
+// the clock
+inline uint16_t countdownUrgencyMillis(uint16_t secondsLeft)
+{
+  if (secondsLeft > 30)
+  {
+    return 3000;
+  }
+  if (secondsLeft >= 15)
+  {
+    return 1000;
+  }
+  if (secondsLeft > 5)
+  {
+    return 500;
+  }
+  return 250;
+}
+
+// Seconds above 59 are carried into minutes
+void countdownStart(Countdown &countdown, unsigned long startMillis, uint8_t minutes, uint8_t seconds);
+// Returns false once less than a second is left
+boolean countdownUpdate(Countdown &countdown, unsigned long nowMillis);
+
+#endif
@@ -0,0 +1,88 @@
+#include "cueSequencer.h"
+#include "main.h"
+#include "hal.h"
+#include "scheduler.h"
+
+static const Cue *timeline;
+static uint8_t nextCue;
+static boolean waiting;
+static unsigned long wakeAtMillis;
+
+void cueStart(const Cue *cues)
+{
+  timeline = cues;
+  nextCue = 0;
+  waiting = false;
+  cueUpdate();
+}
+
+void cueStop()
+{
+  timeline = NULL;
+  waiting = false;
+}
+
+boolean cueRunning()
+{
+  return timeline != NULL;
+}
+
+void cueUpdate()
+{
+  while (timeline != NULL)
+  {
+    if (waiting)
+    {
+      if ((long)(halMillis() - wakeAtMillis) < 0)
+      {
+        return;
+      }
+      waiting = false;
+    }
+
+    Cue cue;
+    memcpy_P(&cue, &timeline[nextCue], sizeof(Cue));
+    nextCue++;
+
+    switch (cue.action)
+    {
+    case CUE_ACTION_SCREEN:
+      displayScreen(cue.screen);
+      break;
+
+    case CUE_ACTION_SOUND:
+      playSound(cue.value);
+      break;
+
+    case CUE_ACTION_WAIT:
+      wakeAtMillis = halMillis() + cue.value;
+      waiting = true;
+      break;
+
+    case CUE_ACTION_CALL:
+      // The call may start another timeline, which simply takes over
+      cue.call();
+      break;
+
+    case CUE_ACTION_END:
+      timeline = NULL;
+      break;
+    }
+  }
+}
+
+unsigned long cueMillisUntilNext()
+{
+  if (timeline == NULL)
+  {
+    return SCHEDULER_IDLE_FOREVER;
+  }
+
+  if (!waiting)
+  {
+    return 0;
+  }
+
+  long remaining = wakeAtMillis - halMillis();
+  return remaining > 0 ? remaining : 0;
+}
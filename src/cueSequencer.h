@@ -0,0 +1,44 @@
+#ifndef CUE_SEQUENCER_H
+#define CUE_SEQUENCER_H
+
+#include <Arduino.h>
+
+struct ScreenDescriptor;
+
+// Plays a timeline of screens, sounds, waits and calls without blocking.
+// Timelines are PROGMEM arrays of Cue ending with CUE_END(); cueUpdate()
+// runs from loop() and executes every step that is due, so the keypad, the
+// buttons and the tickers keep being served while a cue waits.
+
+enum CueAction
+{
+  CUE_ACTION_SCREEN,
+  CUE_ACTION_SOUND,
+  CUE_ACTION_WAIT,
+  CUE_ACTION_CALL,
+  CUE_ACTION_END,
+};
+
+struct Cue
+{
+  uint8_t action;
+  uint16_t value; // wait length in ms or SoundId
+  const ScreenDescriptor *screen;
+  void (*call)();
+};
+
+#define CUE_SCREEN(screen) {CUE_ACTION_SCREEN, 0, screen, NULL}
+#define CUE_SOUND(sound) {CUE_ACTION_SOUND, sound, NULL, NULL}
+#define CUE_WAIT(millis) {CUE_ACTION_WAIT, millis, NULL, NULL}
+#define CUE_CALL(function) {CUE_ACTION_CALL, 0, NULL, function}
+#define CUE_END() {CUE_ACTION_END, 0, NULL, NULL}
+
+// Replaces whatever is playing and runs the first steps right away
+void cueStart(const Cue *timeline);
+void cueStop();
+boolean cueRunning();
+void cueUpdate();
+// How long loop() may idle before the next step is due
+unsigned long cueMillisUntilNext();
+
+#endif
@@ -0,0 +1,156 @@
+#include "gameLog.h"
+#include "config.h"
+#include "hal.h"
+#include "log.h"
+
+#define SECTOR_BYTES 512
+#define RECORD_BYTES 8
+#define RECORDS_PER_SECTOR (SECTOR_BYTES / RECORD_BYTES)
+
+static uint8_t buffer[SECTOR_BYTES];
+static uint8_t buffered; // records in buffer
+static boolean dirty;    // buffer holds records not written yet
+static uint32_t sector;  // where buffer goes in the file
+static uint32_t sectors; // 0 when there is no log
+static uint8_t roundNumber;
+
+static uint8_t recordsIn(const uint8_t *data)
+{
+  uint8_t count = 0;
+  while (count < RECORDS_PER_SECTOR && data[count * RECORD_BYTES + 4] != GAME_LOG_EMPTY)
+  {
+    count++;
+  }
+  return count;
+}
+
+// Records are only ever appended, so the used sectors come first and the
+// end of the log can be found by bisection
+static boolean findEnd()
+{
+  uint32_t low = 0;
+  uint32_t high = sectors;
+  while (low < high)
+  {
+    uint32_t middle = low + (high - low) / 2;
+    if (!halLogReadSector(HAL_LOG_EVENTS, middle, buffer))
+    {
+      return false;
+    }
+    if (recordsIn(buffer) == 0)
+    {
+      high = middle;
+    }
+    else
+    {
+      low = middle + 1;
+    }
+  }
+
+  // Carry on in the last sector if it still has room
+  sector = low;
+  buffered = 0;
+  memset(buffer, 0, SECTOR_BYTES);
+  if (sector > 0)
+  {
+    if (!halLogReadSector(HAL_LOG_EVENTS, sector - 1, buffer))
+    {
+      return false;
+    }
+    buffered = recordsIn(buffer);
+    if (buffered < RECORDS_PER_SECTOR)
+    {
+      sector--;
+    }
+    else
+    {
+      buffered = 0;
+      memset(buffer, 0, SECTOR_BYTES);
+    }
+  }
+  return true;
+}
+
+static boolean erase()
+{
+  memset(buffer, 0, SECTOR_BYTES);
+  for (uint32_t index = 0; index < sectors; index++)
+  {
+    if (!halLogWriteSector(HAL_LOG_EVENTS, index, buffer))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes the buffer back; once its sector is full the next one is started
+static void flush()
+{
+  if (!dirty)
+  {
+    return;
+  }
+  dirty = false;
+
+  if (!halLogWriteSector(HAL_LOG_EVENTS, sector, buffer))
+  {
+    sectors = 0; // stop writing to a card that fails
+    return;
+  }
+
+  if (buffered == RECORDS_PER_SECTOR)
+  {
+    sector++;
+    buffered = 0;
+    memset(buffer, 0, SECTOR_BYTES);
+  }
+}
+
+void gameLogBegin()
+{
+  boolean created;
+  sectors = halLogBegin(HAL_LOG_EVENTS, GAME_LOG_SECTORS, created);
+  dirty = false;
+  sector = 0;
+  roundNumber = 0;
+
+  if (sectors > 0 && ((created && !erase()) || !findEnd()))
+  {
+    sectors = 0;
+  }
+
+  LOG_INFO(SETUP, LOG_GAME_LOG_USED, sector, sectors);
+
+  gameLogRecord(GAME_LOG_BOOT, halMillis(), 0);
+}
+
+void gameLogRecord(uint8_t event, unsigned long atMillis, uint16_t value)
+{
+  if (event == GAME_LOG_ROUND_START)
+  {
+    roundNumber++;
+  }
+
+  if (sector >= sectors)
+  {
+    return; // no card, or the log is full
+  }
+
+  uint8_t *record = buffer + buffered * RECORD_BYTES;
+  record[0] = atMillis;
+  record[1] = atMillis >> 8;
+  record[2] = atMillis >> 16;
+  record[3] = atMillis >> 24;
+  record[4] = event;
+  record[5] = roundNumber;
+  record[6] = value;
+  record[7] = value >> 8;
+  buffered++;
+  dirty = true;
+
+  if (buffered == RECORDS_PER_SECTOR || event == GAME_LOG_DEFUSED || event == GAME_LOG_EXPLODED || event == GAME_LOG_TIME_OVER)
+  {
+    flush();
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include <Arduino.h>
+
+// Append-only record of what happened in each round, kept on the SD card in
+// GAME_LOG_FILE for after the match (tools/decodeGameLog.py turns it into
+// CSV). Records are 8 bytes, little endian:
+//
+//    uint32 millis() when it happened
+//    uint8  GameLogEvent
+//    uint8  round number since boot, 0 before the first round
+//    uint16 value, see GameLogEvent
+//
+// Records are collected in a one sector RAM buffer that is written back
+// with a single sector write, into a file allocated in one piece when it is
+// created, so logging never walks or updates the FAT. The buffer is written
+// when it fills up and when a round ends, which is also when the partly
+// filled sector is rewritten. A full log keeps the oldest records.
+
+#define GAME_LOG_FILE "events.log"
+
+enum GameLogEvent
+{
+  GAME_LOG_EMPTY, // unused space
+  GAME_LOG_BOOT,
+  GAME_LOG_ROUND_START, // value: MenuLevel of the game mode
+  GAME_LOG_PLANTING,    // value: planting time in seconds
+  GAME_LOG_PLANTING_CANCELLED,
+  GAME_LOG_PLANTED, // value: explosion time in minutes
+  GAME_LOG_DEFUSING, // value: defusing time in seconds
+  GAME_LOG_DEFUSING_CANCELLED,
+  GAME_LOG_DEFUSED,
+  GAME_LOG_EXPLODED,
+  GAME_LOG_TIME_OVER,
+};
+
+// Finds where the previous boots stopped and records a GAME_LOG_BOOT. Call
+// once the SD card is up; without it every record is dropped.
+void gameLogBegin();
+void gameLogRecord(uint8_t event, unsigned long atMillis, uint16_t value);
+
+#endif
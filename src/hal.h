@@ -0,0 +1,144 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+// Hardware abstraction layer. The game logic in main.cpp only talks to the
+// peripherals through these functions. halAvr.cpp implements them on top of
+// the Arduino libraries, halNative.cpp on a virtual clock for the host build.
+
+// Clock
+unsigned long halMillis();
+unsigned long halMicros();
+void halDelay(unsigned long ms);
+// Sleeps until the next interrupt, at most maxMillis
+void halIdle(unsigned long maxMillis);
+
+// Free running 16 bit counter, 4 us per tick, for cheap section timing
+void halProfileBegin();
+uint16_t halProfileTicks();
+
+// GPIO
+void halPinMode(uint8_t pin, uint8_t mode);
+void halDigitalWrite(uint8_t pin, uint8_t value);
+uint8_t halDigitalRead(uint8_t pin);
+// Prints what a pin write and read cost through digitalWrite()/digitalRead()
+// compared to Pin<N> (pin.h). setup() runs it in DEBUG builds
+void halPinBenchmark();
+
+// Plant and defuse buttons. Levels are sampled in interrupt context and
+// every change is queued with its micros() timestamp.
+enum HalButton
+{
+  HAL_BUTTON_PLANT,
+  HAL_BUTTON_DEFUSE,
+  HAL_BUTTON_COUNT
+};
+
+struct ButtonEdge
+{
+  uint8_t button;
+  uint8_t level;
+  unsigned long micros;
+};
+
+void halButtonsBegin();
+boolean halButtonPopEdge(ButtonEdge &edge);
+
+// Millisecond timer interrupt, shared by pulseOutput.h and ledEffects.h.
+// Each client's tick runs every millisecond until it returns false; the
+// timer stops once no client is left.
+enum HalTimerClient
+{
+  HAL_TIMER_OUTPUTS,
+  HAL_TIMER_LEDS,
+  HAL_TIMER_CLIENT_COUNT
+};
+
+void halTimerStart(uint8_t client, boolean (*tick)());
+// Worst delay from the timer compare to the ticks starting
+uint16_t halTimerMaxLatencyMicros();
+
+// Effect outputs, played by pulseOutput.h. halOutputWrite() may be called
+// from a timer tick.
+enum HalOutput
+{
+  HAL_OUTPUT_RELAY,
+  HAL_OUTPUT_SMOKE,
+  HAL_OUTPUT_STROBE,
+  HAL_OUTPUT_COUNT
+};
+
+void halOutputsBegin();
+void halOutputWrite(uint8_t output, boolean on);
+
+// Plant and defuse button LEDs (HalButton), played by ledEffects.h. Levels
+// between 0 (off) and 255 (fully on) are 1 kHz PWM made by the timer, which
+// must be running for them. May be called from a timer tick.
+void halButtonLedsBegin();
+void halButtonLedLevel(uint8_t button, uint8_t level);
+
+// Keypad matrix, raw and not debounced. Bit row * KEYPAD_COLS + col is set
+// while that key is down; keypadScanner.h turns the scans into events.
+void halKeypadBegin();
+uint16_t halKeypadScan();
+
+// OLED screen, columns in pixels and rows in 8 pixel pages
+void halOledBegin();
+void halOledClear();
+void halOledClearRegion(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage);
+void halOledText(const char *line, uint8_t column, uint8_t page, boolean big);
+
+// 4 digit LED display, written whole in a single transaction. Digit codes
+// and caching are in ledDisplay.h
+void halLedBegin();
+void halLedWrite(const int8_t digits[4], boolean colon);
+
+// Audio. halSdBegin() also indexes the clips listed in sounds.h, so
+// halAudioPlay() starts from the catalog instead of searching the card.
+// halAudioUpdate() runs from loop() and keeps the playback buffers filled.
+boolean halSdBegin();
+void halAudioBegin();
+void halAudioPlay(uint8_t sound); // SoundId
+void halAudioStop();
+void halAudioUpdate();
+
+struct AudioStats
+{
+  unsigned long cacheHits;   // clips played from RAM
+  unsigned long cacheMisses; // clips streamed from the card
+  uint16_t cacheBytes;       // of SOUND_CACHE_BYTES in use
+  unsigned long dropped;     // clips refused because busier voices outranked them
+  unsigned long startMicros; // from the last halAudioPlay() to its first sample
+  uint16_t isrMaxCycles;     // worst case cost of mixing one output sample
+};
+
+const AudioStats &halAudioStats();
+// Mixed over whatever clip is playing, never stops it
+void halTone(unsigned int frequency, unsigned long durationMs);
+
+// Log files, each a preallocated contiguous file on the SD card accessed in
+// whole sectors, by index from its start. halLogBegin() returns how many
+// sectors are usable, 0 without a card, and sets created when the file was
+// just made and holds whatever the card had there.
+enum HalLogFile
+{
+  HAL_LOG_EVENTS, // gameLog.h
+  HAL_LOG_INPUTS, // inputTrace.h
+  HAL_LOG_FILE_COUNT
+};
+
+uint32_t halLogBegin(uint8_t file, uint32_t sectors, boolean &created);
+boolean halLogReadSector(uint8_t file, uint32_t index, uint8_t *data);
+boolean halLogWriteSector(uint8_t file, uint32_t index, const uint8_t *data);
+
+// EEPROM. Only the bytes that differ are written, each one blocks for
+// about 3.4 ms on AVR.
+void halEepromRead(uint16_t address, void *data, uint16_t length);
+void halEepromUpdate(uint16_t address, const void *data, uint16_t length);
+
+// System
+int halFreeMemory();
+void halReset();
+
+#endif
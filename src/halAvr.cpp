@@ -0,0 +1,527 @@
+#ifdef ARDUINO
+
+#include "hal.h"
+#include "config.h"
+#include "log.h"
+#include <SPI.h>
+#include <Wire.h>
+#include "SSD1306Ascii.h"
+#include "SSD1306AsciiAvrI2c.h"
+#include <TM1637.h>
+#include "MemoryFree.h"
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
+#include "ringBuffer.h"
+#include "pin.h"
+#include "soundCatalog.h"
+#include "audioEngine.h"
+#include "soundCache.h"
+#include "gameLog.h"
+#include "inputTrace.h"
+
+#include <SdFat.h>
+
+SdFat sd;
+
+static const char *const logFileNames[HAL_LOG_FILE_COUNT] = {GAME_LOG_FILE, INPUT_TRACE_FILE};
+static uint32_t logFirstSector[HAL_LOG_FILE_COUNT];
+static uint32_t logSectors[HAL_LOG_FILE_COUNT];
+
+const uint8_t rowPins[KEYPAD_ROWS] = {41, 38, 42, 40}; //connect to the row pinouts of the keypad
+const uint8_t colPins[KEYPAD_COLS] = {47, 45, 43};     //connect to the column pinouts of the keypad
+
+#if LED_DISPLAY_CONNECTED
+TM1637 led4DigitDisplay(LED_SCREEN_CLK_PIN, LED_SCREEN_DIO_PIN);
+#endif
+
+// Declaration for an SSD1306 display connected to I2C (SDA, SCL pins)
+SSD1306AsciiAvrI2c display;
+
+void (*resetFunc)(void) = 0; // Reset Arduino
+
+unsigned long halMillis()
+{
+  return millis();
+}
+
+unsigned long halMicros()
+{
+  return micros();
+}
+
+void halDelay(unsigned long ms)
+{
+  delay(ms);
+}
+
+void halIdle(unsigned long maxMillis)
+{
+  // Timer0 wakes us up at least every 1.024 ms, well inside any budget
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+}
+
+void halProfileBegin()
+{
+  // Timer1 is not used by the audio engine on pin 46 (Timer5)
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11) | _BV(CS10); // Normal mode, clk/64
+}
+
+uint16_t halProfileTicks()
+{
+  return TCNT1;
+}
+
+void halPinMode(uint8_t pin, uint8_t mode)
+{
+  pinMode(pin, mode);
+}
+
+void halDigitalWrite(uint8_t pin, uint8_t value)
+{
+  digitalWrite(pin, value);
+}
+
+uint8_t halDigitalRead(uint8_t pin)
+{
+  return digitalRead(pin);
+}
+
+#if DEBUG
+// Times a single statement in CPU cycles: Timer1 runs at clk/1 in normal
+// mode for the duration, with interrupts off. Whatever the profiler had
+// configured is put back afterwards.
+#define MEASURE_CYCLES(result, statement) \
+  do                                      \
+  {                                       \
+    uint8_t sreg = SREG;                  \
+    cli();                                \
+    uint8_t tccr1a = TCCR1A;              \
+    uint8_t tccr1b = TCCR1B;              \
+    TCCR1A = 0;                           \
+    TCCR1B = _BV(CS10);                   \
+    TCNT1 = 0;                            \
+    statement;                            \
+    result = TCNT1;                       \
+    TCCR1A = tccr1a;                      \
+    TCCR1B = tccr1b;                      \
+    SREG = sreg;                          \
+  } while (0)
+
+void halPinBenchmark()
+{
+  volatile uint8_t sink;
+  uint16_t overhead, slowWrite, fastWrite, slowRead, fastRead;
+
+  MEASURE_CYCLES(overhead, );
+  MEASURE_CYCLES(slowWrite, digitalWrite(PLANT_BUTTON_LED_PIN, LOW));
+  MEASURE_CYCLES(fastWrite, Pin<PLANT_BUTTON_LED_PIN>::low());
+  MEASURE_CYCLES(slowRead, sink = digitalRead(PLANT_BUTTON_PIN));
+  MEASURE_CYCLES(fastRead, sink = Pin<PLANT_BUTTON_PIN>::read());
+  (void)sink;
+
+  LOG_INFO(SETUP, LOG_PIN_WRITE_CYCLES, slowWrite - overhead, fastWrite - overhead);
+  LOG_INFO(SETUP, LOG_PIN_READ_CYCLES, slowRead - overhead, fastRead - overhead);
+}
+#endif
+
+// A0 and A1 live on PORTF, which has no pin change interrupt on the
+// ATmega2560, so the buttons are sampled from the Timer0 compare B
+// interrupt instead. Timer0 already runs millis(); its compare B unit is
+// free and fires once per overflow, every 1.024 ms.
+static RingBuffer<ButtonEdge, 16> buttonEdges;
+static uint8_t buttonLevels; // one bit per button, as last sampled
+
+void halButtonsBegin()
+{
+  Pin<PLANT_BUTTON_PIN>::input();
+  Pin<DEFUSE_BUTTON_PIN>::input();
+
+  // Start from released so a button held at boot still produces a press
+  buttonLevels = 0;
+  OCR0B = 0x80;
+  TIMSK0 |= _BV(OCIE0B);
+}
+
+static inline void sampleButton(uint8_t button, uint8_t level)
+{
+  uint8_t bit = 1 << button;
+  if ((level ? bit : 0) != (buttonLevels & bit))
+  {
+    buttonLevels ^= bit;
+    ButtonEdge edge = {button, level, micros()};
+    buttonEdges.push(edge);
+  }
+}
+
+ISR(TIMER0_COMPB_vect)
+{
+  sampleButton(HAL_BUTTON_PLANT, Pin<PLANT_BUTTON_PIN>::read());
+  sampleButton(HAL_BUTTON_DEFUSE, Pin<DEFUSE_BUTTON_PIN>::read());
+}
+
+boolean halButtonPopEdge(ButtonEdge &edge)
+{
+  return buttonEdges.pop(edge);
+}
+
+// Timer3 is free: Timer0 runs millis() and samples the buttons, Timer1 is
+// the profiler and Timer5 the audio engine. CTC mode at clk/8 compares every
+// 2000 counts, 1 ms; the count on entry is how late the interrupt started.
+// Pins 36 and 37 have no PWM of their own, so the button LEDs are switched
+// on at the start of each period and off again by compare B and C.
+#define TIMER3_TOP 1999
+
+static boolean (*volatile timerTicks[HAL_TIMER_CLIENT_COUNT])();
+static volatile uint16_t timerMaxLatencyCounts;
+static volatile uint8_t pwmLeds; // bit per button LED dimmed by the timer
+
+static const uint8_t ledCompareBits[HAL_BUTTON_COUNT] = {_BV(OCIE3B), _BV(OCIE3C)};
+
+void halTimerStart(uint8_t client, boolean (*tick)())
+{
+  uint8_t sreg = SREG;
+  cli();
+  timerTicks[client] = tick;
+  if (TCCR3B == 0)
+  {
+    TCCR3A = 0;
+    OCR3A = TIMER3_TOP;
+    TCNT3 = 0;
+    TIFR3 = _BV(OCF3A) | _BV(OCF3B) | _BV(OCF3C);
+    TCCR3B = _BV(WGM32) | _BV(CS31);
+  }
+  TIMSK3 |= _BV(OCIE3A);
+  SREG = sreg;
+}
+
+uint16_t halTimerMaxLatencyMicros()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t counts = timerMaxLatencyCounts;
+  SREG = sreg;
+  return counts / 2;
+}
+
+ISR(TIMER3_COMPA_vect)
+{
+  uint16_t latency = TCNT3;
+  if (latency > timerMaxLatencyCounts)
+  {
+    timerMaxLatencyCounts = latency;
+  }
+
+  if (pwmLeds & _BV(HAL_BUTTON_PLANT))
+  {
+    Pin<PLANT_BUTTON_LED_PIN>::high();
+  }
+  if (pwmLeds & _BV(HAL_BUTTON_DEFUSE))
+  {
+    Pin<DEFUSE_BUTTON_LED_PIN>::high();
+  }
+
+  // halReset() keeps the timer running into a sketch that has not set a tick
+  boolean running = false;
+  for (uint8_t client = 0; client < HAL_TIMER_CLIENT_COUNT; client++)
+  {
+    if (timerTicks[client] != NULL && !timerTicks[client]())
+    {
+      timerTicks[client] = NULL;
+    }
+    running = running || timerTicks[client] != NULL;
+  }
+
+  if (!running)
+  {
+    TIMSK3 = 0;
+    TCCR3B = 0;
+    pwmLeds = 0;
+  }
+}
+
+ISR(TIMER3_COMPB_vect)
+{
+  Pin<PLANT_BUTTON_LED_PIN>::low();
+}
+
+ISR(TIMER3_COMPC_vect)
+{
+  Pin<DEFUSE_BUTTON_LED_PIN>::low();
+}
+
+void halOutputsBegin()
+{
+  Pin<ELECTRIC_EXPLOSION_RELAY_PIN>::output();
+  Pin<SMOKE_MACHINE_PIN>::output();
+  Pin<STROBE_PIN>::output();
+}
+
+void halOutputWrite(uint8_t output, boolean on)
+{
+  switch (output)
+  {
+  case HAL_OUTPUT_RELAY:
+    Pin<ELECTRIC_EXPLOSION_RELAY_PIN>::write(on);
+    break;
+  case HAL_OUTPUT_SMOKE:
+    Pin<SMOKE_MACHINE_PIN>::write(on);
+    break;
+  case HAL_OUTPUT_STROBE:
+    Pin<STROBE_PIN>::write(on);
+    break;
+  }
+}
+
+void halButtonLedsBegin()
+{
+  Pin<PLANT_BUTTON_LED_PIN>::output();
+  Pin<DEFUSE_BUTTON_LED_PIN>::output();
+}
+
+void halButtonLedLevel(uint8_t button, uint8_t level)
+{
+  uint8_t sreg = SREG;
+  cli();
+  if (level == 0 || level == 255)
+  {
+    pwmLeds &= ~_BV(button);
+    TIMSK3 &= ~ledCompareBits[button];
+    if (button == HAL_BUTTON_PLANT)
+    {
+      Pin<PLANT_BUTTON_LED_PIN>::write(level != 0);
+    }
+    else
+    {
+      Pin<DEFUSE_BUTTON_LED_PIN>::write(level != 0);
+    }
+  }
+  else
+  {
+    // Compare registers are not buffered in CTC mode; a value below the
+    // count leaves the LED on for the rest of this period
+    uint16_t compare = ((uint16_t)level * 125) >> 4;
+    if (button == HAL_BUTTON_PLANT)
+    {
+      OCR3B = compare;
+    }
+    else
+    {
+      OCR3C = compare;
+    }
+    pwmLeds |= _BV(button);
+    TIMSK3 |= ledCompareBits[button];
+  }
+  SREG = sreg;
+}
+
+void halKeypadBegin()
+{
+  for (uint8_t row = 0; row < KEYPAD_ROWS; row++)
+  {
+    pinMode(rowPins[row], INPUT_PULLUP);
+  }
+  // Columns float until they are scanned
+  for (uint8_t col = 0; col < KEYPAD_COLS; col++)
+  {
+    pinMode(colPins[col], INPUT);
+  }
+}
+
+// Drives one column low at a time; a pressed key pulls its row low with it
+uint16_t halKeypadScan()
+{
+  uint16_t down = 0;
+  for (uint8_t col = 0; col < KEYPAD_COLS; col++)
+  {
+    pinMode(colPins[col], OUTPUT);
+    digitalWrite(colPins[col], LOW);
+    for (uint8_t row = 0; row < KEYPAD_ROWS; row++)
+    {
+      if (digitalRead(rowPins[row]) == LOW)
+      {
+        down |= 1 << (row * KEYPAD_COLS + col);
+      }
+    }
+    pinMode(colPins[col], INPUT);
+  }
+  return down;
+}
+
+void halOledBegin()
+{
+#if DISPLAY_CONNECTED
+  display.begin(&Adafruit128x64, 0x3C);
+  display.setFont(Adafruit5x7);
+#endif
+}
+
+void halOledClear()
+{
+#if DISPLAY_CONNECTED
+  display.clear();
+#endif
+}
+
+void halOledClearRegion(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage)
+{
+#if DISPLAY_CONNECTED
+  display.clear(firstColumn, lastColumn, firstPage, lastPage);
+#endif
+}
+
+void halOledText(const char *line, uint8_t column, uint8_t page, boolean big)
+{
+#if DISPLAY_CONNECTED
+  if (big)
+  {
+    display.set2X();
+  }
+  else
+  {
+    display.set1X();
+  }
+  display.setCursor(column, page);
+  display.print(line);
+#endif
+}
+
+void halLedBegin()
+{
+#if LED_DISPLAY_CONNECTED
+  led4DigitDisplay.set();
+  led4DigitDisplay.init();
+#endif
+}
+
+void halLedWrite(const int8_t digits[4], boolean colon)
+{
+#if LED_DISPLAY_CONNECTED
+  // point() only sets the flag; display() sends the four digits behind a
+  // single auto-increment address command
+  int8_t codes[4];
+  memcpy(codes, digits, sizeof(codes));
+  led4DigitDisplay.point(colon);
+  led4DigitDisplay.display(codes);
+#endif
+}
+
+boolean halSdBegin()
+{
+#if SD_CARD_CONNECTED
+  if (!sd.begin(SS))
+  {
+    return false;
+  }
+  soundCatalogBegin();
+  soundCacheBegin();
+  return true;
+#else
+  return false;
+#endif
+}
+
+void halAudioBegin()
+{
+  audioEngineBegin();
+}
+
+void halAudioPlay(uint8_t sound)
+{
+#if SD_CARD_CONNECTED
+  audioEnginePlay(sound);
+#endif
+}
+
+void halAudioStop()
+{
+  audioEngineStop();
+}
+
+void halAudioUpdate()
+{
+#if SD_CARD_CONNECTED
+  audioEngineUpdate();
+#endif
+}
+
+const AudioStats &halAudioStats()
+{
+  static AudioStats stats;
+  const SoundCacheStats &cache = soundCacheStats();
+  stats.cacheHits = cache.hits;
+  stats.cacheMisses = cache.misses;
+  stats.cacheBytes = cache.bytesUsed;
+  AudioEngineStats engine = audioEngineStats();
+  stats.dropped = engine.dropped;
+  stats.startMicros = engine.startMicros;
+  stats.isrMaxCycles = engine.isrMaxCycles;
+  return stats;
+}
+
+void halTone(unsigned int frequency, unsigned long durationMs)
+{
+  audioEngineBeep(frequency, durationMs < 0xFFFF ? durationMs : 0xFFFF);
+}
+
+uint32_t halLogBegin(uint8_t file, uint32_t sectors, boolean &created)
+{
+  logSectors[file] = 0;
+  created = false;
+#if SD_CARD_CONNECTED
+  const char *name = logFileNames[file];
+  FsFile log;
+  if (!log.open(name, O_RDWR))
+  {
+    // Allocated in one piece up front, so writes never touch the FAT
+    created = log.open(name, O_RDWR | O_CREAT) && log.preAllocate(sectors * 512UL);
+    if (!created)
+    {
+      log.close();
+      sd.remove(name);
+      return 0;
+    }
+  }
+
+  uint32_t lastSector;
+  if (log.contiguousRange(&logFirstSector[file], &lastSector))
+  {
+    logSectors[file] = min(log.fileSize() / 512, lastSector - logFirstSector[file] + 1);
+  }
+  log.close();
+#endif
+  return logSectors[file];
+}
+
+boolean halLogReadSector(uint8_t file, uint32_t index, uint8_t *data)
+{
+  return index < logSectors[file] && sd.card()->readSector(logFirstSector[file] + index, data);
+}
+
+boolean halLogWriteSector(uint8_t file, uint32_t index, const uint8_t *data)
+{
+  return index < logSectors[file] && sd.card()->writeSector(logFirstSector[file] + index, data);
+}
+
+void halEepromRead(uint16_t address, void *data, uint16_t length)
+{
+  eeprom_read_block(data, (const void *)(uintptr_t)address, length);
+}
+
+void halEepromUpdate(uint16_t address, const void *data, uint16_t length)
+{
+  eeprom_update_block(data, (void *)(uintptr_t)address, length);
+}
+
+int halFreeMemory()
+{
+  return freeMemory();
+}
+
+void halReset()
+{
+  resetFunc();
+}
+
+#endif
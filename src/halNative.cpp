@@ -0,0 +1,517 @@
+#ifndef ARDUINO
+
+#include "halNative.h"
+#include "config.h"
+#include <vector>
+#include "ringBuffer.h"
+#include "sounds.h"
+
+HostSerial Serial;
+
+#define NATIVE_PIN_COUNT 70
+#define NATIVE_EEPROM_BYTES 4096
+
+static unsigned long long virtualMicros;
+static unsigned long clockQuantumMicros = 10;
+static unsigned long long deadlineMicros;
+static boolean deadlineSet;
+static void (*idleCallback)();
+
+static std::vector<HalNativeEvent> timeline;
+static uint16_t keysDown;
+// The keypad is polled, and the real board wakes from Timer0 every
+// millisecond; until this time halIdle() does the same so the scanner gets
+// its next scan after a key change
+static unsigned long long pollUntilMicros;
+static uint8_t pinLevels[NATIVE_PIN_COUNT];
+static RingBuffer<ButtonEdge, 16> buttonEdges;
+
+static int8_t ledDigits[4];
+static boolean ledPoint;
+
+// Both survive halNativeInit(), like a card left in the slot and the
+// EEPROM of the board
+static std::vector<uint8_t> logFiles[HAL_LOG_FILE_COUNT];
+static std::vector<uint8_t> eeprom(NATIVE_EEPROM_BYTES, 0xFF);
+
+static const char *lastSound;
+static unsigned long soundsPlayed;
+
+static const uint8_t outputPins[HAL_OUTPUT_COUNT] = {ELECTRIC_EXPLOSION_RELAY_PIN, SMOKE_MACHINE_PIN, STROBE_PIN};
+static unsigned long outputPulses[HAL_OUTPUT_COUNT];
+static uint8_t buttonLedLevels[HAL_BUTTON_COUNT];
+// The timer ticks every millisecond while a client has a tick
+static boolean (*timerTicks[HAL_TIMER_CLIENT_COUNT])();
+static unsigned long long nextTickMicros;
+
+static boolean timerRunning()
+{
+  for (uint8_t client = 0; client < HAL_TIMER_CLIENT_COUNT; client++)
+  {
+    if (timerTicks[client] != NULL)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void applyDueEvents()
+{
+  unsigned long now = (unsigned long)(virtualMicros / 1000ULL);
+  size_t applied = 0;
+  while (applied < timeline.size() && timeline[applied].atMillis <= now)
+  {
+    const HalNativeEvent &event = timeline[applied];
+    if (event.type == HAL_NATIVE_KEY_DOWN || event.type == HAL_NATIVE_KEY_UP)
+    {
+      const char *label = strchr(KEYPAD_KEYMAP, event.value);
+      if (label != NULL && event.value != '\0')
+      {
+        uint16_t bit = 1 << (label - KEYPAD_KEYMAP);
+        keysDown = event.type == HAL_NATIVE_KEY_DOWN ? keysDown | bit : keysDown & ~bit;
+        pollUntilMicros = event.atMillis * 1000ULL + 2 * KEYPAD_SCAN_MILLIS * 1000ULL;
+      }
+    }
+    else if (event.pin < NATIVE_PIN_COUNT)
+    {
+      if (pinLevels[event.pin] != event.value && (event.pin == PLANT_BUTTON_PIN || event.pin == DEFUSE_BUTTON_PIN))
+      {
+        ButtonEdge edge = {event.pin == PLANT_BUTTON_PIN ? (uint8_t)HAL_BUTTON_PLANT : (uint8_t)HAL_BUTTON_DEFUSE,
+                           (uint8_t)event.value,
+                           (unsigned long)(uint32_t)(event.atMillis * 1000ULL)};
+        buttonEdges.push(edge);
+      }
+      pinLevels[event.pin] = event.value;
+    }
+    applied++;
+  }
+
+  if (applied > 0)
+  {
+    timeline.erase(timeline.begin(), timeline.begin() + applied);
+  }
+}
+
+void halNativeAdvanceMicros(unsigned long micros)
+{
+  virtualMicros += micros;
+  applyDueEvents();
+
+  while (nextTickMicros <= virtualMicros && timerRunning())
+  {
+    nextTickMicros += 1000ULL;
+    for (uint8_t client = 0; client < HAL_TIMER_CLIENT_COUNT; client++)
+    {
+      if (timerTicks[client] != NULL && !timerTicks[client]())
+      {
+        timerTicks[client] = NULL;
+      }
+    }
+  }
+
+  if (deadlineSet && virtualMicros >= deadlineMicros)
+  {
+    throw HalNativeStop();
+  }
+}
+
+void halNativeInit()
+{
+  virtualMicros = 0;
+  deadlineSet = false;
+  timeline.clear();
+  keysDown = 0;
+  pollUntilMicros = 0;
+  memset(pinLevels, 0, sizeof(pinLevels));
+  buttonEdges.clear();
+  memset(ledDigits, 0x7f, sizeof(ledDigits));
+  ledPoint = false;
+  lastSound = "";
+  soundsPlayed = 0;
+  memset(outputPulses, 0, sizeof(outputPulses));
+  memset(timerTicks, 0, sizeof(timerTicks));
+  memset(buttonLedLevels, 0, sizeof(buttonLedLevels));
+}
+
+void halNativeSetClockQuantumMicros(unsigned long micros)
+{
+  clockQuantumMicros = micros;
+}
+
+void halNativeOnIdle(void (*callback)())
+{
+  idleCallback = callback;
+}
+
+void halNativeSetDeadline(unsigned long atMillis)
+{
+  deadlineMicros = atMillis * 1000ULL;
+  deadlineSet = true;
+}
+
+unsigned long halNativeNowMillis()
+{
+  return (unsigned long)(uint32_t)(virtualMicros / 1000ULL);
+}
+
+void halNativeSchedule(const HalNativeEvent &event)
+{
+  std::vector<HalNativeEvent>::iterator position = timeline.end();
+  while (position != timeline.begin() && (position - 1)->atMillis > event.atMillis)
+  {
+    --position;
+  }
+  timeline.insert(position, event);
+}
+
+boolean halNativePendingEvents()
+{
+  return !timeline.empty();
+}
+
+uint8_t halNativePinLevel(uint8_t pin)
+{
+  return pin < NATIVE_PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+boolean halNativeRelayOn()
+{
+  return pinLevels[ELECTRIC_EXPLOSION_RELAY_PIN] == HIGH;
+}
+
+unsigned long halNativeOutputPulses(uint8_t output)
+{
+  return outputPulses[output];
+}
+
+const char *halNativeLastSound()
+{
+  return lastSound;
+}
+
+unsigned long halNativeSoundsPlayed()
+{
+  return soundsPlayed;
+}
+
+unsigned long halMillis()
+{
+  halNativeAdvanceMicros(clockQuantumMicros);
+  return (unsigned long)(uint32_t)(virtualMicros / 1000ULL);
+}
+
+unsigned long halMicros()
+{
+  halNativeAdvanceMicros(clockQuantumMicros);
+  return (unsigned long)(uint32_t)virtualMicros;
+}
+
+void halDelay(unsigned long ms)
+{
+  halNativeAdvanceMicros(ms * 1000UL);
+}
+
+void halIdle(unsigned long maxMillis)
+{
+  if (idleCallback != NULL)
+  {
+    idleCallback();
+  }
+
+  // Jump straight to the next input or deadline, that is what makes host
+  // runs much faster than real time
+  unsigned long long wakeMicros = virtualMicros + maxMillis * 1000ULL;
+  if (maxMillis == 0xFFFFFFFFUL || wakeMicros < virtualMicros)
+  {
+    wakeMicros = ~0ULL;
+  }
+
+  // The real board wakes from the timer too, and the outputs watchdog
+  // counts on loop() running. The button LEDs need no loop() to run.
+  if ((virtualMicros < pollUntilMicros || timerTicks[HAL_TIMER_OUTPUTS] != NULL) && virtualMicros + 1000ULL < wakeMicros)
+  {
+    wakeMicros = virtualMicros + 1000ULL;
+  }
+
+  if (!timeline.empty() && timeline.front().atMillis * 1000ULL < wakeMicros)
+  {
+    wakeMicros = timeline.front().atMillis * 1000ULL;
+  }
+
+  if (deadlineSet && deadlineMicros < wakeMicros)
+  {
+    wakeMicros = deadlineMicros;
+  }
+
+  if (wakeMicros != ~0ULL && wakeMicros > virtualMicros)
+  {
+    halNativeAdvanceMicros(wakeMicros - virtualMicros);
+  }
+}
+
+void halProfileBegin()
+{
+}
+
+uint16_t halProfileTicks()
+{
+  return (uint16_t)(virtualMicros / 4ULL);
+}
+
+unsigned long millis()
+{
+  return halMillis();
+}
+
+unsigned long micros()
+{
+  return halMicros();
+}
+
+void delay(unsigned long ms)
+{
+  halDelay(ms);
+}
+
+void halPinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void halDigitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin < NATIVE_PIN_COUNT)
+  {
+    pinLevels[pin] = value;
+  }
+}
+
+uint8_t halDigitalRead(uint8_t pin)
+{
+  applyDueEvents();
+  return halNativePinLevel(pin);
+}
+
+void halPinBenchmark()
+{
+  // Host cycle counts say nothing about the ATmega2560
+}
+
+void halButtonsBegin()
+{
+}
+
+boolean halButtonPopEdge(ButtonEdge &edge)
+{
+  applyDueEvents();
+  return buttonEdges.pop(edge);
+}
+
+void halOutputsBegin()
+{
+}
+
+void halOutputWrite(uint8_t output, boolean on)
+{
+  uint8_t pin = outputPins[output];
+  if (on && pinLevels[pin] == LOW)
+  {
+    outputPulses[output]++;
+  }
+  pinLevels[pin] = on ? HIGH : LOW;
+}
+
+void halTimerStart(uint8_t client, boolean (*tick)())
+{
+  if (!timerRunning())
+  {
+    nextTickMicros = (virtualMicros / 1000ULL + 1) * 1000ULL;
+  }
+  timerTicks[client] = tick;
+}
+
+uint16_t halTimerMaxLatencyMicros()
+{
+  return 0; // ticks run exactly on the virtual clock
+}
+
+void halButtonLedsBegin()
+{
+}
+
+void halButtonLedLevel(uint8_t button, uint8_t level)
+{
+  buttonLedLevels[button] = level;
+  pinLevels[button == HAL_BUTTON_PLANT ? PLANT_BUTTON_LED_PIN : DEFUSE_BUTTON_LED_PIN] = level != 0 ? HIGH : LOW;
+}
+
+uint8_t halNativeButtonLedLevel(uint8_t button)
+{
+  return buttonLedLevels[button];
+}
+
+void halKeypadBegin()
+{
+}
+
+uint16_t halKeypadScan()
+{
+  halNativeAdvanceMicros(clockQuantumMicros);
+  return keysDown;
+}
+
+void halOledBegin()
+{
+}
+
+void halOledClear()
+{
+}
+
+void halOledClearRegion(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage)
+{
+}
+
+void halOledText(const char *line, uint8_t column, uint8_t page, boolean big)
+{
+}
+
+void halLedBegin()
+{
+  memset(ledDigits, 0x7f, sizeof(ledDigits));
+  ledPoint = false;
+}
+
+void halLedWrite(const int8_t digits[4], boolean colon)
+{
+  memcpy(ledDigits, digits, sizeof(ledDigits));
+  ledPoint = colon;
+}
+
+boolean halSdBegin()
+{
+  return SD_CARD_CONNECTED;
+}
+
+void halAudioBegin()
+{
+}
+
+void halAudioPlay(uint8_t sound)
+{
+  lastSound = soundFileName(sound);
+  soundsPlayed++;
+}
+
+void halAudioStop()
+{
+}
+
+void halAudioUpdate()
+{
+}
+
+const AudioStats &halAudioStats()
+{
+  static AudioStats stats;
+  return stats;
+}
+
+void halTone(unsigned int frequency, unsigned long durationMs)
+{
+}
+
+uint32_t halLogBegin(uint8_t file, uint32_t sectors, boolean &created)
+{
+  std::vector<uint8_t> &logFile = logFiles[file];
+  created = logFile.empty();
+  if (created)
+  {
+    logFile.assign(sectors * 512UL, 0xA5); // not erased, like a real card
+  }
+  return logFile.size() / 512;
+}
+
+boolean halLogReadSector(uint8_t file, uint32_t index, uint8_t *data)
+{
+  std::vector<uint8_t> &logFile = logFiles[file];
+  if ((index + 1) * 512UL > logFile.size())
+  {
+    return false;
+  }
+  memcpy(data, &logFile[index * 512UL], 512);
+  return true;
+}
+
+boolean halLogWriteSector(uint8_t file, uint32_t index, const uint8_t *data)
+{
+  std::vector<uint8_t> &logFile = logFiles[file];
+  if ((index + 1) * 512UL > logFile.size())
+  {
+    return false;
+  }
+  memcpy(&logFile[index * 512UL], data, 512);
+  return true;
+}
+
+boolean halNativeLoadLog(uint8_t file, const char *path)
+{
+  FILE *input = fopen(path, "rb");
+  if (input == NULL)
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> &logFile = logFiles[file];
+  logFile.clear();
+  uint8_t sector[512];
+  size_t length;
+  while ((length = fread(sector, 1, sizeof(sector), input)) > 0)
+  {
+    logFile.insert(logFile.end(), sector, sector + length);
+  }
+  fclose(input);
+  logFile.resize((logFile.size() + 511) / 512 * 512, 0);
+  return !logFile.empty();
+}
+
+boolean halNativeSaveLog(uint8_t file, const char *path)
+{
+  std::vector<uint8_t> &logFile = logFiles[file];
+  FILE *output = fopen(path, "wb");
+  if (output == NULL)
+  {
+    return false;
+  }
+
+  boolean written = fwrite(logFile.data(), 1, logFile.size(), output) == logFile.size();
+  return fclose(output) == 0 && written;
+}
+
+void halEepromRead(uint16_t address, void *data, uint16_t length)
+{
+  if (address + length <= NATIVE_EEPROM_BYTES)
+  {
+    memcpy(data, &eeprom[address], length);
+  }
+}
+
+void halEepromUpdate(uint16_t address, const void *data, uint16_t length)
+{
+  if (address + length <= NATIVE_EEPROM_BYTES)
+  {
+    memcpy(&eeprom[address], data, length);
+  }
+}
+
+int halFreeMemory()
+{
+  return 8192;
+}
+
+void halReset()
+{
+  throw HalNativeReset();
+}
+
+#endif
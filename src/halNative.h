@@ -0,0 +1,71 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#ifndef ARDUINO
+
+#include "hal.h"
+
+// Host side controls of the virtual hardware. Inputs are scheduled on the
+// virtual timeline and applied lazily whenever the sketch reads the clock or
+// an input, so they also reach code that busy-waits inside loop().
+
+enum HalNativeEventType
+{
+  HAL_NATIVE_KEY_DOWN,
+  HAL_NATIVE_KEY_UP,
+  HAL_NATIVE_PIN,
+};
+
+struct HalNativeEvent
+{
+  unsigned long atMillis;
+  HalNativeEventType type;
+  uint8_t pin; // HAL_NATIVE_PIN only
+  char value;  // key label (KEYPAD_KEYMAP) or pin level
+};
+
+// Thrown out of the sketch when the virtual deadline is reached
+struct HalNativeStop
+{
+};
+
+// Thrown out of the sketch by halReset()
+struct HalNativeReset
+{
+};
+
+// Puts the virtual hardware back to its power-on state
+void halNativeInit();
+
+// Virtual cost of every clock read, which is what lets busy-wait loops
+// make progress on the host
+void halNativeSetClockQuantumMicros(unsigned long micros);
+void halNativeAdvanceMicros(unsigned long micros);
+void halNativeSetDeadline(unsigned long atMillis);
+// Called each time the sketch goes idle, before the clock jumps ahead, so a
+// host runner sees the state an iteration left at the time it left it
+void halNativeOnIdle(void (*callback)());
+// Reads the virtual clock without advancing it
+unsigned long halNativeNowMillis();
+
+void halNativeSchedule(const HalNativeEvent &event);
+boolean halNativePendingEvents();
+
+// Puts a file copied from the card in place of log file (HalLogFile), as if
+// it had been on the card at boot
+boolean halNativeLoadLog(uint8_t file, const char *path);
+// Copies log file (HalLogFile) off the virtual card
+boolean halNativeSaveLog(uint8_t file, const char *path);
+
+uint8_t halNativePinLevel(uint8_t pin);
+boolean halNativeRelayOn();
+// Times output (HalOutput) was switched on since halNativeInit()
+unsigned long halNativeOutputPulses(uint8_t output);
+// Last level of a button LED (HalButton), 0 to 255
+uint8_t halNativeButtonLedLevel(uint8_t button);
+const char *halNativeLastSound();
+unsigned long halNativeSoundsPlayed();
+
+#endif
+
+#endif
@@ -0,0 +1,424 @@
+#include "inputTrace.h"
+#include "config.h"
+#include "hal.h"
+#include "scheduler.h"
+
+#define SECTOR_BYTES 512
+#define MAX_RECORD_BYTES 13
+
+#define KIND_BOOT 0x10
+#define KIND_KEY 0x20
+#define KIND_BUTTON 0x30
+#define KIND_MASK 0xF0
+
+struct TraceRecord
+{
+  uint8_t head;
+  unsigned long consumedMillis; // on the recording's clock
+  unsigned long age;
+  char key;
+  char heldKey;
+};
+
+static uint8_t buffer[SECTOR_BYTES];
+static uint16_t used;    // bytes of buffer in use
+static boolean dirty;    // buffer holds records not written yet
+static uint32_t sector;  // where buffer goes in the file
+static uint32_t sectors; // 0 when there is no trace
+static boolean recording;
+static unsigned long lastMillis; // of the last record written or read
+
+static uint16_t replayBoot = INPUT_TRACE_LAST_BOOT;
+static boolean replayRequested;
+static boolean replaying;
+static long replayOffset; // replay clock minus recording clock
+static TraceRecord next;
+
+static uint8_t putVarint(uint8_t *data, unsigned long value)
+{
+  uint8_t length = 0;
+  while (value >= 0x80)
+  {
+    data[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  data[length++] = value;
+  return length;
+}
+
+// Returns the bytes read, 0 when the number runs past the end
+static uint8_t getVarint(const uint8_t *data, uint16_t available, unsigned long &value)
+{
+  value = 0;
+  for (uint8_t length = 0; length < available && length < 5; length++)
+  {
+    value |= (unsigned long)(data[length] & 0x7F) << (7 * length);
+    if (!(data[length] & 0x80))
+    {
+      return length + 1;
+    }
+  }
+  return 0;
+}
+
+// Decodes the record at data, returns its length, 0 at the end of the sector
+static uint8_t decode(const uint8_t *data, uint16_t available, TraceRecord &record)
+{
+  if (available == 0 || data[0] == 0)
+  {
+    return 0;
+  }
+
+  record.head = data[0];
+  if ((record.head & KIND_MASK) == KIND_BOOT)
+  {
+    if (available < 5)
+    {
+      return 0;
+    }
+    record.consumedMillis = data[1] | (unsigned long)data[2] << 8 | (unsigned long)data[3] << 16 | (unsigned long)data[4] << 24;
+    return 5;
+  }
+
+  unsigned long delta;
+  uint8_t length = 1;
+  uint8_t field = getVarint(data + length, available - length, delta);
+  length += field;
+  if (field == 0)
+  {
+    return 0;
+  }
+  field = getVarint(data + length, available - length, record.age);
+  length += field;
+  if (field == 0)
+  {
+    return 0;
+  }
+  record.consumedMillis = lastMillis + delta;
+
+  if ((record.head & KIND_MASK) == KIND_KEY)
+  {
+    boolean chord = (record.head & 0x0F) == KEY_CHORD;
+    if (length + (chord ? 2 : 1) > available)
+    {
+      return 0;
+    }
+    record.key = data[length++];
+    record.heldKey = chord ? data[length++] : '\0';
+  }
+  return length;
+}
+
+static void writeSector()
+{
+  dirty = false;
+  if (!halLogWriteSector(HAL_LOG_INPUTS, sector, buffer))
+  {
+    sectors = 0; // stop writing to a card that fails
+  }
+}
+
+static void append(const uint8_t *record, uint8_t length)
+{
+  if (used + length > SECTOR_BYTES)
+  {
+    if (dirty)
+    {
+      writeSector();
+    }
+    sector++;
+    used = 0;
+    memset(buffer, 0, SECTOR_BYTES);
+  }
+
+  if (sector >= sectors)
+  {
+    recording = false; // no card, or the trace is full
+    return;
+  }
+
+  memcpy(buffer + used, record, length);
+  used += length;
+  dirty = true;
+}
+
+static uint16_t usedIn(const uint8_t *data)
+{
+  uint16_t offset = 0;
+  TraceRecord record;
+  uint8_t length;
+  while ((length = decode(data + offset, SECTOR_BYTES - offset, record)) > 0)
+  {
+    offset += length;
+  }
+  return offset;
+}
+
+// Records are only ever appended, so the used sectors come first
+static boolean findEnd()
+{
+  uint32_t low = 0;
+  uint32_t high = sectors;
+  while (low < high)
+  {
+    uint32_t middle = low + (high - low) / 2;
+    if (!halLogReadSector(HAL_LOG_INPUTS, middle, buffer))
+    {
+      return false;
+    }
+    if (buffer[0] == 0)
+    {
+      high = middle;
+    }
+    else
+    {
+      low = middle + 1;
+    }
+  }
+
+  sector = low;
+  used = 0;
+  memset(buffer, 0, SECTOR_BYTES);
+  if (sector > 0)
+  {
+    if (!halLogReadSector(HAL_LOG_INPUTS, sector - 1, buffer))
+    {
+      return false;
+    }
+    // Carry on in the last sector; a full one is moved past by append()
+    sector--;
+    used = usedIn(buffer);
+  }
+  return true;
+}
+
+static boolean erase()
+{
+  memset(buffer, 0, SECTOR_BYTES);
+  for (uint32_t index = 0; index < sectors; index++)
+  {
+    if (!halLogWriteSector(HAL_LOG_INPUTS, index, buffer))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the record at sector and used into next, moving to the next sector
+// at the end of one. False at the end of the trace.
+static boolean readNext()
+{
+  while (sector < sectors)
+  {
+    uint8_t length = decode(buffer + used, SECTOR_BYTES - used, next);
+    if (length > 0)
+    {
+      used += length;
+      lastMillis = next.consumedMillis;
+      return true;
+    }
+
+    if (used == 0 || ++sector >= sectors || !halLogReadSector(HAL_LOG_INPUTS, sector, buffer))
+    {
+      return false; // an empty sector ends the trace
+    }
+    used = 0;
+  }
+  return false;
+}
+
+// Leaves next on the boot record of the wanted boot
+static boolean findBoot(uint16_t boot)
+{
+  uint32_t bootSector = 0;
+  uint16_t bootUsed = 0;
+  uint16_t count = 0;
+
+  sector = 0;
+  used = 0;
+  lastMillis = 0;
+  if (sectors == 0 || !halLogReadSector(HAL_LOG_INPUTS, 0, buffer))
+  {
+    return false;
+  }
+
+  uint32_t recordSector = sector;
+  uint16_t recordUsed = used;
+  while (readNext())
+  {
+    if ((next.head & KIND_MASK) == KIND_BOOT)
+    {
+      bootSector = recordSector;
+      bootUsed = recordUsed;
+      if (count++ == boot)
+      {
+        break;
+      }
+    }
+    recordSector = sector;
+    recordUsed = used;
+  }
+
+  if (count == 0 || (boot != INPUT_TRACE_LAST_BOOT && count <= boot))
+  {
+    return false;
+  }
+
+  sector = bootSector;
+  used = bootUsed;
+  return halLogReadSector(HAL_LOG_INPUTS, sector, buffer) && readNext();
+}
+
+static void beginReplay()
+{
+  boolean created;
+  sectors = halLogBegin(HAL_LOG_INPUTS, INPUT_TRACE_SECTORS, created);
+  if (created || !findBoot(replayBoot))
+  {
+    sectors = 0;
+    return;
+  }
+
+  replayOffset = halMillis() - next.consumedMillis;
+  replaying = readNext() && (next.head & KIND_MASK) != KIND_BOOT;
+}
+
+void inputTraceReplayBoot(uint16_t boot)
+{
+  replayBoot = boot;
+  replayRequested = true;
+}
+
+void inputTraceBegin()
+{
+  recording = false;
+  replaying = false;
+  dirty = false;
+  if (replayRequested)
+  {
+    beginReplay();
+    return;
+  }
+
+  boolean created;
+  sectors = halLogBegin(HAL_LOG_INPUTS, INPUT_TRACE_SECTORS, created);
+  sector = 0;
+  if (sectors == 0 || (created && !erase()) || !findEnd())
+  {
+    sectors = 0;
+    return;
+  }
+
+  recording = true;
+  lastMillis = halMillis();
+  uint8_t record[5] = {KIND_BOOT, (uint8_t)lastMillis, (uint8_t)(lastMillis >> 8), (uint8_t)(lastMillis >> 16), (uint8_t)(lastMillis >> 24)};
+  append(record, sizeof(record));
+  inputTraceFlush();
+}
+
+boolean inputTraceReplaying()
+{
+  return replaying;
+}
+
+static uint8_t putTimes(uint8_t *record, unsigned long eventMillis)
+{
+  unsigned long now = halMillis();
+  uint8_t length = putVarint(record, now - lastMillis);
+  length += putVarint(record + length, now - eventMillis);
+  lastMillis = now;
+  return length;
+}
+
+void inputTraceRecordKey(const KeyEvent &event)
+{
+  if (!recording)
+  {
+    return;
+  }
+
+  uint8_t record[MAX_RECORD_BYTES];
+  uint8_t length = 0;
+  record[length++] = KIND_KEY | event.type;
+  length += putTimes(record + length, event.atMillis);
+  record[length++] = event.key;
+  if (event.type == KEY_CHORD)
+  {
+    record[length++] = event.heldKey;
+  }
+  append(record, length);
+}
+
+void inputTraceRecordButton(const ButtonEvent &event)
+{
+  if (!recording)
+  {
+    return;
+  }
+
+  uint8_t record[MAX_RECORD_BYTES];
+  uint8_t length = 0;
+  record[length++] = KIND_BUTTON | event.button << 1 | (event.pressed ? 1 : 0);
+  length += putTimes(record + length, event.atMillis);
+  append(record, length);
+}
+
+void inputTraceFlush()
+{
+  if (recording && dirty)
+  {
+    writeSector();
+  }
+}
+
+// True when next is of kind and due on the replay clock
+static boolean due(uint8_t kind)
+{
+  return replaying && (next.head & KIND_MASK) == kind && (long)(halMillis() - (next.consumedMillis + replayOffset)) >= 0;
+}
+
+static void advance()
+{
+  replaying = readNext() && (next.head & KIND_MASK) != KIND_BOOT;
+}
+
+boolean inputTraceNextKey(KeyEvent &event)
+{
+  if (!due(KIND_KEY))
+  {
+    return false;
+  }
+
+  event.type = next.head & 0x0F;
+  event.key = next.key;
+  event.heldKey = next.heldKey;
+  event.atMillis = next.consumedMillis + replayOffset - next.age;
+  advance();
+  return true;
+}
+
+boolean inputTraceNextButton(ButtonEvent &event)
+{
+  if (!due(KIND_BUTTON))
+  {
+    return false;
+  }
+
+  event.button = (next.head >> 1) & 0x07;
+  event.pressed = next.head & 1;
+  event.atMillis = next.consumedMillis + replayOffset - next.age;
+  advance();
+  return true;
+}
+
+unsigned long inputTraceMillisUntilNext()
+{
+  if (!replaying)
+  {
+    return SCHEDULER_IDLE_FOREVER;
+  }
+
+  long remaining = next.consumedMillis + replayOffset - halMillis();
+  return remaining > 0 ? remaining : 0;
+}
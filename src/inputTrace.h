@@ -0,0 +1,50 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <Arduino.h>
+#include "keypadScanner.h"
+#include "buttons.h"
+
+// Every keypad and button event loop() consumes, with the millis() it was
+// consumed at, kept on the SD card in INPUT_TRACE_FILE. Replaying a boot
+// feeds the same events back at the same times after boot, so the game
+// goes through the same states; the live keypad and buttons are ignored
+// until the trace runs out. tools/decodeInputTrace.py lists a trace.
+//
+// Records are appended in sectors like the game log (gameLog.h) and never
+// span two sectors; a zero byte where a record would start ends the
+// sector. Numbers marked varint take 7 bits per byte, low bits first, the
+// top bit set on all but the last byte.
+//
+//    head    kind << 4 | detail
+//    boot    head 0x10, uint32 millis() little endian
+//    key     head 0x20 | KeyEventType, varint millis since the previous
+//            record, varint age of the event, key, held key (chords only)
+//    button  head 0x30 | button << 1 | pressed, varint millis since the
+//            previous record, varint age of the event
+//
+// The age is how long before it was consumed the event happened, which is
+// the timestamp the game gets. A key press takes about 5 bytes.
+
+#define INPUT_TRACE_FILE "inputs.trc"
+#define INPUT_TRACE_LAST_BOOT 0xFFFF
+
+// Makes the next inputTraceBegin() replay that boot of the trace, counted
+// from 0, instead of recording
+void inputTraceReplayBoot(uint16_t boot);
+// Call once the SD card is up
+void inputTraceBegin();
+boolean inputTraceReplaying();
+
+void inputTraceRecordKey(const KeyEvent &event);
+void inputTraceRecordButton(const ButtonEvent &event);
+// Writes the records buffered so far. A sector is also written when it fills
+void inputTraceFlush();
+
+// Replay side: the next recorded event once its time has come. Events come
+// in recorded order, so a button event holds back the keys behind it.
+boolean inputTraceNextKey(KeyEvent &event);
+boolean inputTraceNextButton(ButtonEvent &event);
+unsigned long inputTraceMillisUntilNext();
+
+#endif
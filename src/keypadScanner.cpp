@@ -0,0 +1,147 @@
+#include "keypadScanner.h"
+#include "config.h"
+#include "hal.h"
+#include "ringBuffer.h"
+#include "scheduler.h"
+
+#define KEY_COUNT (KEYPAD_ROWS * KEYPAD_COLS)
+
+static const char keymap[KEY_COUNT + 1] PROGMEM = KEYPAD_KEYMAP;
+
+static RingBuffer<KeyEvent, 16> events;
+
+static uint16_t stableKeys; // debounced, what the events describe
+static uint16_t rawKeys;    // as of the last scan
+static unsigned long rawChangedAtMillis;
+static unsigned long lastScanMillis;
+
+static unsigned long downSinceMillis[KEY_COUNT];
+// Keys whose hold already turned into a long press or a chord, so it is
+// not reported a second time
+static uint16_t holdReported;
+
+static char keyLabel(uint8_t key)
+{
+  return pgm_read_byte(&keymap[key]);
+}
+
+static void push(uint8_t type, uint8_t key, char heldKey, unsigned long atMillis)
+{
+  KeyEvent event;
+  event.type = type;
+  event.key = keyLabel(key);
+  event.heldKey = heldKey;
+  event.atMillis = atMillis;
+  events.push(event);
+}
+
+static void pressed(uint8_t key, unsigned long atMillis)
+{
+  downSinceMillis[key] = atMillis;
+
+  // A chord needs exactly one other key down, and down long enough not to
+  // be the previous key of a fast typist
+  uint16_t others = stableKeys & ~(1 << key);
+  if (others != 0 && (others & (others - 1)) == 0)
+  {
+    uint8_t held = 0;
+    while (!(others & (1 << held)))
+    {
+      held++;
+    }
+
+    if (atMillis - downSinceMillis[held] >= KEYPAD_CHORD_MILLIS)
+    {
+      holdReported |= (1 << key) | (1 << held);
+      push(KEY_CHORD, key, keyLabel(held), atMillis);
+      return;
+    }
+  }
+
+  push(KEY_PRESS, key, '\0', atMillis);
+}
+
+static void reportLongPresses(unsigned long now)
+{
+  uint16_t candidates = stableKeys & ~holdReported;
+  for (uint8_t key = 0; candidates != 0; key++, candidates >>= 1)
+  {
+    if ((candidates & 1) && now - downSinceMillis[key] >= KEYPAD_LONG_PRESS_MILLIS)
+    {
+      holdReported |= 1 << key;
+      push(KEY_LONG_PRESS, key, '\0', downSinceMillis[key] + KEYPAD_LONG_PRESS_MILLIS);
+    }
+  }
+}
+
+void keypadBegin()
+{
+  halKeypadBegin();
+  events.clear();
+  stableKeys = 0;
+  rawKeys = 0;
+  holdReported = 0;
+  lastScanMillis = halMillis() - KEYPAD_SCAN_MILLIS;
+}
+
+void keypadUpdate()
+{
+  unsigned long now = halMillis();
+  if (now - lastScanMillis < KEYPAD_SCAN_MILLIS)
+  {
+    return;
+  }
+  lastScanMillis = now;
+
+  uint16_t scanned = halKeypadScan();
+  if (scanned != rawKeys)
+  {
+    // Still bouncing, or the first scan of a change: wait for the next one
+    rawKeys = scanned;
+    rawChangedAtMillis = now;
+  }
+  else if (scanned != stableKeys)
+  {
+    uint16_t changed = scanned ^ stableKeys;
+
+    // Releases first, so a key swapped for another in one scan does not
+    // make a chord with itself
+    for (uint8_t key = 0; key < KEY_COUNT; key++)
+    {
+      uint16_t bit = 1 << key;
+      if ((changed & bit) && !(scanned & bit))
+      {
+        stableKeys &= ~bit;
+        holdReported &= ~bit;
+        push(KEY_RELEASE, key, '\0', rawChangedAtMillis);
+      }
+    }
+    for (uint8_t key = 0; key < KEY_COUNT; key++)
+    {
+      uint16_t bit = 1 << key;
+      if ((changed & bit) && (scanned & bit))
+      {
+        pressed(key, rawChangedAtMillis);
+        stableKeys |= bit;
+      }
+    }
+  }
+
+  reportLongPresses(now);
+}
+
+boolean keypadPoll(KeyEvent &event)
+{
+  return events.pop(event);
+}
+
+unsigned long keypadMillisUntilNext()
+{
+  if (stableKeys == 0 && rawKeys == 0)
+  {
+    return SCHEDULER_IDLE_FOREVER;
+  }
+
+  unsigned long elapsed = halMillis() - lastScanMillis;
+  return elapsed >= KEYPAD_SCAN_MILLIS ? 0 : KEYPAD_SCAN_MILLIS - elapsed;
+}
@@ -0,0 +1,40 @@
+#ifndef KEYPAD_SCANNER_H
+#define KEYPAD_SCANNER_H
+
+#include <Arduino.h>
+
+// Keypad events built from rate limited matrix scans (halKeypadScan()). A
+// scan costs a few dozen pin operations, so it runs every KEYPAD_SCAN_MILLIS
+// instead of on every loop() pass. A change counts once two scans in a row
+// agree on it, and is stamped with the first of them.
+//
+// Besides press and release, a key held KEYPAD_LONG_PRESS_MILLIS reports a
+// long press, and a key pressed while one other key is held reports a chord
+// in place of its press (see KEYPAD_CHORD_MILLIS).
+
+enum KeyEventType
+{
+  KEY_PRESS,
+  KEY_RELEASE,
+  KEY_LONG_PRESS,
+  KEY_CHORD,
+};
+
+struct KeyEvent
+{
+  uint8_t type; // KeyEventType
+  char key;
+  char heldKey;           // KEY_CHORD only, the key that was already down
+  unsigned long atMillis; // when the change was first scanned
+};
+
+void keypadBegin();
+// Scans the matrix when the scan interval is due
+void keypadUpdate();
+// Returns the next event, if any
+boolean keypadPoll(KeyEvent &event);
+// Time until keypadUpdate() has something to do. While no key is down or
+// settling this is forever: loop() passes often enough to catch a press.
+unsigned long keypadMillisUntilNext();
+
+#endif
@@ -0,0 +1,51 @@
+#include "ledDisplay.h"
+#include "hal.h"
+
+static int8_t shown[LED_DIGITS];
+static boolean shownColon;
+static LedDisplayStats stats;
+
+static void send()
+{
+  unsigned long start = halMicros();
+  halLedWrite(shown, shownColon);
+  stats.lastMicros = halMicros() - start;
+  if (stats.lastMicros > stats.maxMicros)
+  {
+    stats.maxMicros = stats.lastMicros;
+  }
+  stats.updates++;
+}
+
+void ledDisplayBegin()
+{
+  halLedBegin();
+  memset(&stats, 0, sizeof(stats));
+  memset(shown, LED_BLANK, sizeof(shown));
+  shownColon = false;
+  send();
+}
+
+void ledDisplayShow(const int8_t digits[LED_DIGITS], boolean colon)
+{
+  if (colon == shownColon && memcmp(digits, shown, sizeof(shown)) == 0)
+  {
+    stats.unchanged++;
+    return;
+  }
+
+  memcpy(shown, digits, sizeof(shown));
+  shownColon = colon;
+  send();
+}
+
+void ledDisplayClear()
+{
+  const int8_t blank[LED_DIGITS] = {LED_BLANK, LED_BLANK, LED_BLANK, LED_BLANK};
+  ledDisplayShow(blank, false);
+}
+
+const LedDisplayStats &ledDisplayStats()
+{
+  return stats;
+}
@@ -0,0 +1,28 @@
+#ifndef LED_DISPLAY_H
+#define LED_DISPLAY_H
+
+#include <Arduino.h>
+
+// Keeps a copy of what the TM1637 4 digit display shows, the digit codes
+// and the colon, and only talks to it when that changes. A change goes out
+// as one auto-increment write of all four digits; there is no clear first,
+// so the display never flickers blank between two values.
+
+#define LED_DIGITS 4
+#define LED_BLANK 0x7f // digit code that lights no segment
+
+struct LedDisplayStats
+{
+  unsigned long updates;    // frames sent to the display
+  unsigned long unchanged;  // frames skipped, the display already showed them
+  unsigned long lastMicros; // bus time of the last frame sent
+  unsigned long maxMicros;
+};
+
+void ledDisplayBegin();
+// Digit 0 is the leftmost one, each a value 0 to 15 or LED_BLANK
+void ledDisplayShow(const int8_t digits[LED_DIGITS], boolean colon);
+void ledDisplayClear();
+const LedDisplayStats &ledDisplayStats();
+
+#endif
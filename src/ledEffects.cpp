@@ -0,0 +1,179 @@
+#include "ledEffects.h"
+#include "hal.h"
+#include "countdown.h"
+
+#define BREATHE_STEPS 64 // up and down through BREATHE_LEVELS
+#define FLASH_MILLIS 60
+
+enum LedEffect
+{
+  LED_EFFECT_STEADY,
+  LED_EFFECT_BLINK,
+  LED_EFFECT_BREATHE,
+  LED_EFFECT_COUNTDOWN,
+};
+
+// Squares of 0 to 1, so the fade looks even to the eye
+const uint8_t BREATHE_LEVELS[BREATHE_STEPS / 2] PROGMEM = {
+    0, 0, 1, 2, 4, 7, 10, 13, 17, 21, 27, 32, 38, 45, 52, 60,
+    68, 77, 86, 96, 106, 117, 128, 140, 153, 166, 179, 193, 208, 223, 239, 255};
+
+// Owned by the timer tick while an effect is animated; the loop() side
+// only touches it with interrupts off
+struct LedState
+{
+  uint8_t effect;
+  uint8_t level;
+  uint8_t step;         // of the breathe
+  uint16_t elapsed;     // ticks into the current blink, step or flash
+  uint16_t stepMillis;  // blink half period, breathe step, or flash interval
+  uint16_t secondsLeft; // countdown, with millisLeft below a second
+  uint16_t millisLeft;
+};
+
+static LedState leds[HAL_BUTTON_COUNT];
+static volatile boolean timerRunning;
+
+static void setLevel(uint8_t led, LedState &state, uint8_t level)
+{
+  if (state.level != level)
+  {
+    state.level = level;
+    halButtonLedLevel(led, level);
+  }
+}
+
+static void tickLed(uint8_t led, LedState &state)
+{
+  switch (state.effect)
+  {
+  case LED_EFFECT_BLINK:
+    if (++state.elapsed >= state.stepMillis)
+    {
+      state.elapsed = 0;
+      setLevel(led, state, state.level ? 0 : 255);
+    }
+    break;
+
+  case LED_EFFECT_BREATHE:
+    if (++state.elapsed >= state.stepMillis)
+    {
+      state.elapsed = 0;
+      state.step = (state.step + 1) % BREATHE_STEPS;
+      uint8_t index = state.step < BREATHE_STEPS / 2 ? state.step : BREATHE_STEPS - 1 - state.step;
+      setLevel(led, state, pgm_read_byte(&BREATHE_LEVELS[index]));
+    }
+    break;
+
+  case LED_EFFECT_COUNTDOWN:
+    // Counted down by subtraction, the tick has no time for a division
+    if (state.millisLeft > 0)
+    {
+      state.millisLeft--;
+    }
+    else if (state.secondsLeft > 0)
+    {
+      state.secondsLeft--;
+      state.millisLeft = 999;
+    }
+
+    state.stepMillis = countdownUrgencyMillis(state.secondsLeft);
+    if (++state.elapsed >= state.stepMillis)
+    {
+      state.elapsed = 0;
+    }
+    setLevel(led, state, state.elapsed < FLASH_MILLIS ? 255 : 0);
+    break;
+  }
+}
+
+// Runs every millisecond in interrupt context while an effect is animated
+static boolean tick()
+{
+  boolean active = false;
+  for (uint8_t led = 0; led < HAL_BUTTON_COUNT; led++)
+  {
+    tickLed(led, leds[led]);
+    active = active || leds[led].effect != LED_EFFECT_STEADY;
+  }
+
+  timerRunning = active;
+  return active;
+}
+
+// Called with interrupts off
+static void steady(uint8_t led, uint8_t level)
+{
+  leds[led].effect = LED_EFFECT_STEADY;
+  leds[led].level = level;
+  halButtonLedLevel(led, level);
+}
+
+static void animate(uint8_t led, uint8_t effect, uint16_t stepMillis)
+{
+  LedState &state = leds[led];
+  state.effect = effect;
+  state.step = 0;
+  state.elapsed = 0;
+  state.stepMillis = stepMillis > 0 ? stepMillis : 1;
+
+  if (!timerRunning)
+  {
+    timerRunning = true;
+    halTimerStart(HAL_TIMER_LEDS, tick);
+  }
+}
+
+void ledEffectsBegin()
+{
+  halButtonLedsBegin();
+  // After a reset the timer may still be ticking, starting it again is harmless
+  timerRunning = false;
+  for (uint8_t led = 0; led < HAL_BUTTON_COUNT; led++)
+  {
+    steady(led, 0);
+  }
+}
+
+void ledEffectOff(uint8_t led)
+{
+  noInterrupts();
+  steady(led, 0);
+  interrupts();
+}
+
+void ledEffectOn(uint8_t led)
+{
+  noInterrupts();
+  steady(led, 255);
+  interrupts();
+}
+
+void ledEffectBlink(uint8_t led, uint16_t periodMillis)
+{
+  noInterrupts();
+  steady(led, 255);
+  animate(led, LED_EFFECT_BLINK, periodMillis / 2);
+  interrupts();
+}
+
+void ledEffectBreathe(uint8_t led, uint16_t periodMillis)
+{
+  noInterrupts();
+  steady(led, 0);
+  animate(led, LED_EFFECT_BREATHE, periodMillis / BREATHE_STEPS);
+  interrupts();
+}
+
+void ledEffectCountdown(uint8_t led, unsigned long millisLeft)
+{
+  uint16_t secondsLeft = millisLeft / 1000;
+  uint16_t belowSecond = millisLeft - secondsLeft * 1000UL;
+
+  noInterrupts();
+  steady(led, 255);
+  animate(led, LED_EFFECT_COUNTDOWN, countdownUrgencyMillis(secondsLeft));
+  leds[led].secondsLeft = secondsLeft;
+  leds[led].millisLeft = belowSecond;
+  interrupts();
+}
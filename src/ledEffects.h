@@ -0,0 +1,21 @@
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include <Arduino.h>
+
+// Effects on the plant and defuse button LEDs (HalButton), played from the
+// millisecond timer tick with PWM levels (hal.h), so loop() does nothing
+// for them once started. Starting an effect replaces the previous one.
+
+void ledEffectsBegin();
+void ledEffectOff(uint8_t led);
+void ledEffectOn(uint8_t led);
+// On for half the period, off for the other half
+void ledEffectBlink(uint8_t led, uint16_t periodMillis);
+// Fades up and back down once per period
+void ledEffectBreathe(uint8_t led, uint16_t periodMillis);
+// Short flashes that come faster as the deadline nears, on the same
+// countdownUrgencyMillis() curve as the bomb's beep
+void ledEffectCountdown(uint8_t led, unsigned long millisLeft);
+
+#endif
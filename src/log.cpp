@@ -0,0 +1,62 @@
+#include "log.h"
+#include "hal.h"
+#include "telemetry.h"
+
+#define HEADER_BYTES 7
+#define MAX_ARGUMENTS 3
+
+static void putUint32(uint8_t *bytes, uint32_t value)
+{
+  bytes[0] = value;
+  bytes[1] = value >> 8;
+  bytes[2] = value >> 16;
+  bytes[3] = value >> 24;
+}
+
+static boolean waitForRoom;
+
+void logWaitForRoom(boolean wait)
+{
+  waitForRoom = wait;
+}
+
+static void send(uint8_t level, uint8_t message, const long *arguments, uint8_t count)
+{
+  if (waitForRoom)
+  {
+    Serial.flush();
+  }
+
+  uint8_t payload[HEADER_BYTES + 4 * MAX_ARGUMENTS];
+  payload[0] = TELEMETRY_LOG;
+  payload[1] = level;
+  payload[2] = message;
+  putUint32(payload + 3, halMillis());
+  for (uint8_t i = 0; i < count; i++)
+  {
+    putUint32(payload + HEADER_BYTES + 4 * i, arguments[i]);
+  }
+  telemetrySendFrame(payload, HEADER_BYTES + 4 * count);
+}
+
+void logSend(uint8_t level, uint8_t message)
+{
+  send(level, message, NULL, 0);
+}
+
+void logSend(uint8_t level, uint8_t message, long a)
+{
+  send(level, message, &a, 1);
+}
+
+void logSend(uint8_t level, uint8_t message, long a, long b)
+{
+  long arguments[] = {a, b};
+  send(level, message, arguments, 2);
+}
+
+void logSend(uint8_t level, uint8_t message, long a, long b, long c)
+{
+  long arguments[] = {a, b, c};
+  send(level, message, arguments, 3);
+}
@@ -0,0 +1,61 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Leveled logging with the formatting left to the host. A log site sends a
+// telemetry frame (telemetry.h) with its level, the message ID from
+// logMessages.def, millis() and up to three arguments as raw 32 bit
+// values, so the strings never reach flash and no number is converted to
+// decimal on the board. tools/telemetryViewer.py prints the text.
+//
+//   LOG_INFO(GAME, LOG_PLANTED, explosionCountdown.end.atMillis);
+//
+// Every module has its own level, LOG_LEVEL_<module> in config.h. A site
+// above it is a constant false condition, so it compiles to nothing and
+// its arguments are not evaluated. Like telemetry, a log frame that does
+// not fit the Serial transmit buffer is dropped rather than waited for.
+
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+enum LogMessage
+{
+#define LOG_MESSAGE(id, format) id,
+#include "logMessages.def"
+#undef LOG_MESSAGE
+  LOG_MESSAGE_COUNT
+};
+
+// True when any module logs, which is when setup() opens Serial
+#define LOG_TO_SERIAL (LOG_LEVEL_SETUP || LOG_LEVEL_KEYPAD || LOG_LEVEL_GAME || LOG_LEVEL_DISPLAY || LOG_LEVEL_SOUND || LOG_LEVEL_PROFILE)
+
+// While set, a log site waits for the transmit buffer to drain instead of
+// dropping its frame. For bursts off the game path, setup() and the
+// profiler dump, which would otherwise lose all but the first few lines.
+void logWaitForRoom(boolean wait);
+
+void logSend(uint8_t level, uint8_t message);
+void logSend(uint8_t level, uint8_t message, long a);
+void logSend(uint8_t level, uint8_t message, long a, long b);
+void logSend(uint8_t level, uint8_t message, long a, long b, long c);
+
+#define LOG_AT(level, module, ...)     \
+  do                                   \
+  {                                    \
+    if (LOG_LEVEL_##module >= (level)) \
+    {                                  \
+      logSend((level), __VA_ARGS__);   \
+    }                                  \
+  } while (0)
+
+#define LOG_ERROR(module, ...) LOG_AT(LOG_LEVEL_ERROR, module, __VA_ARGS__)
+#define LOG_WARN(module, ...) LOG_AT(LOG_LEVEL_WARN, module, __VA_ARGS__)
+#define LOG_INFO(module, ...) LOG_AT(LOG_LEVEL_INFO, module, __VA_ARGS__)
+#define LOG_DEBUG(module, ...) LOG_AT(LOG_LEVEL_DEBUG, module, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,131 @@
+#include "loopProfiler.h"
+
+#if LOOP_PROFILER
+
+#include "hal.h"
+#include "log.h"
+
+#define MICROS_PER_TICK 4
+#define TICK_WRAP_MILLIS 250
+
+static unsigned long histogram[LOOP_PROFILER_BUCKETS];
+static uint16_t sectionMaxTicks[SECTION_COUNT];
+static unsigned long iterations;
+static unsigned long maxStallMicros;
+static unsigned long maxStallAtMillis;
+static uint8_t maxStallSection;
+
+static uint16_t sectionStartTicks;
+static unsigned long iterationStartMillis;
+static unsigned long iterationTicks;
+static uint16_t iterationWorstTicks;
+static uint8_t iterationWorstSection;
+
+static uint8_t log2Bucket(unsigned long micros)
+{
+  uint8_t bucket = 0;
+  while (micros > 1 && bucket < LOOP_PROFILER_BUCKETS - 1)
+  {
+    micros >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void resetStatistics()
+{
+  memset(histogram, 0, sizeof(histogram));
+  memset(sectionMaxTicks, 0, sizeof(sectionMaxTicks));
+  iterations = 0;
+  maxStallMicros = 0;
+  maxStallAtMillis = 0;
+  maxStallSection = SECTION_KEYPAD;
+}
+
+void loopProfilerBegin()
+{
+  halProfileBegin();
+  resetStatistics();
+}
+
+void loopProfilerStartIteration()
+{
+  sectionStartTicks = halProfileTicks();
+  iterationStartMillis = halMillis();
+  iterationTicks = 0;
+  iterationWorstTicks = 0;
+  iterationWorstSection = SECTION_KEYPAD;
+}
+
+void loopProfilerMark(LoopSection section)
+{
+  uint16_t now = halProfileTicks();
+  uint16_t elapsed = now - sectionStartTicks;
+  sectionStartTicks = now;
+  iterationTicks += elapsed;
+
+  if (elapsed > sectionMaxTicks[section])
+  {
+    sectionMaxTicks[section] = elapsed;
+  }
+
+  if (elapsed > iterationWorstTicks)
+  {
+    iterationWorstTicks = elapsed;
+    iterationWorstSection = section;
+  }
+}
+
+void loopProfilerEndIteration()
+{
+  unsigned long elapsedMillis = halMillis() - iterationStartMillis;
+  unsigned long micros = iterationTicks * MICROS_PER_TICK;
+  if (elapsedMillis >= TICK_WRAP_MILLIS)
+  {
+    micros = elapsedMillis * 1000UL;
+  }
+
+  histogram[log2Bucket(micros)]++;
+  iterations++;
+
+  if (micros > maxStallMicros)
+  {
+    maxStallMicros = micros;
+    maxStallSection = iterationWorstSection;
+    maxStallAtMillis = iterationStartMillis;
+  }
+}
+
+boolean loopProfilerDumpRequested(const KeyEvent &event)
+{
+  return event.type == KEY_CHORD && event.key == LOOP_PROFILER_DUMP_KEY && event.heldKey == LOOP_PROFILER_DUMP_HOLD_KEY;
+}
+
+void loopProfilerDump()
+{
+  logWaitForRoom(true);
+  LOG_INFO(PROFILE, LOG_PROFILE_ITERATIONS, iterations);
+
+  for (uint8_t i = 0; i < LOOP_PROFILER_BUCKETS; i++)
+  {
+    if (histogram[i] != 0)
+    {
+      LOG_INFO(PROFILE, LOG_PROFILE_BUCKET, 1UL << (i + 1), histogram[i]);
+    }
+  }
+
+  LOG_INFO(PROFILE, LOG_PROFILE_MAX_STALL, maxStallMicros, maxStallSection, maxStallAtMillis);
+  for (uint8_t i = 0; i < SECTION_COUNT; i++)
+  {
+    LOG_INFO(PROFILE, LOG_PROFILE_SECTION, i, (unsigned long)sectionMaxTicks[i] * MICROS_PER_TICK);
+  }
+
+  const AudioStats &audio = halAudioStats();
+  LOG_INFO(PROFILE, LOG_PROFILE_SOUND_CACHE, audio.cacheHits, audio.cacheMisses, audio.cacheBytes);
+  LOG_INFO(PROFILE, LOG_PROFILE_AUDIO, audio.dropped, audio.isrMaxCycles, audio.startMicros);
+  logWaitForRoom(false);
+
+  resetStatistics();
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include "config.h"
+
+// Measures every loop() iteration into a log2 histogram and remembers the
+// worst stall together with the section that caused it. Sections are timed
+// with halProfileTicks() (4 us per tick, a plain timer register read on
+// AVR), so a mark costs a handful of cycles. A single section longer than
+// 262 ms wraps the tick counter; the iteration total falls back to millis()
+// in that case so long stalls are still reported with the right length.
+//
+// Hold '#' and press '*' to dump the statistics as PROFILE log messages.
+// While the profiler is built in, '#' acts when it is released rather than
+// when it is pressed, see handleKeyEvent().
+
+#if LOOP_PROFILER
+
+#include <Arduino.h>
+#include "keypadScanner.h"
+
+enum LoopSection
+{
+  SECTION_KEYPAD,
+  SECTION_ACTION,
+  SECTION_BUTTONS,
+  SECTION_SCHEDULER,
+  SECTION_AUDIO,
+  SECTION_CUES,
+  SECTION_COUNT
+};
+
+#define LOOP_PROFILER_BUCKETS 20
+#define LOOP_PROFILER_DUMP_HOLD_KEY '#'
+#define LOOP_PROFILER_DUMP_KEY '*'
+
+void loopProfilerBegin();
+void loopProfilerStartIteration();
+void loopProfilerMark(LoopSection section);
+void loopProfilerEndIteration();
+boolean loopProfilerDumpRequested(const KeyEvent &event);
+void loopProfilerDump();
+
+#define PROFILE_BEGIN() loopProfilerBegin()
+#define PROFILE_ITERATION_START() loopProfilerStartIteration()
+#define PROFILE_MARK(section) loopProfilerMark(section)
+#define PROFILE_ITERATION_END() loopProfilerEndIteration()
+
+#else
+
+#define PROFILE_BEGIN()
+#define PROFILE_ITERATION_START()
+#define PROFILE_MARK(section)
+#define PROFILE_ITERATION_END()
+
+#endif
+
+#endif
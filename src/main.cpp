@@ -1,90 +1,36 @@
 #include <main.h>
 #include <Arduino.h>
-#include <SPI.h>
-#include <Wire.h>
-#include "SSD1306Ascii.h"
-#include "SSD1306AsciiAvrI2c.h"
-#include <Ticker.h>
-#include <TM1637.h>
-#include <Keypad.h>
-
-#define DEBUG true
-#define DISPLAY_CONNECTED true
-#define LED_DISPLAY_CONNECTED true
-#define SD_CARD_CONNECTED true
-
-#if DEBUG
-#include "MemoryFree.h"
+#include "config.h"
+#include "hal.h"
+#include "loopProfiler.h"
+#include "screen.h"
+#include "screens.h"
+#include "memoryStats.h"
+#include "cueSequencer.h"
+#include "setupWizard.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "keypadScanner.h"
+#include "gameLog.h"
+#include "telemetry.h"
+#include "log.h"
+#include "presets.h"
+#include "countdown.h"
+#include "ledDisplay.h"
+#include "inputTrace.h"
+#include "pulseOutput.h"
+#include "ledEffects.h"
+#include "sounds.h"
+
+SchedulerTimer beepBombTimer = schedulerCreate(beepBomb, 3000);
+SchedulerTimer updateGameTimeTimer = schedulerCreate(updateGameTime, 1000);
+SchedulerTimer defusingTimer = schedulerCreate(defusingCallback, 1000);
+SchedulerTimer plantingTimer = schedulerCreate(plantingCallback, 1000);
+SchedulerTimer explodingTimer = schedulerCreate(explodingCallback, 1000);
+#if TELEMETRY
+SchedulerTimer telemetryTimer = schedulerCreate(sendTelemetry, TELEMETRY_INTERVAL_MILLIS);
 #endif
 
-#include <SdFat.h>
-
-SdFat sd;
-
-#include <TMRpcm.h>
-
-enum MenuLevel
-{
-  MAIN,
-  SEARCH_DESTROY,
-  SABOTAGE,
-};
-
-enum Runtime
-{
-  SETTINGS,
-  PLAYING,
-  PLANTING,
-  PLANTED,
-  EXPLODED,
-  DEFUSING,
-  DEFUSED,
-  TIME_OVER,
-  END
-};
-
-#define SDFAT_FILE_TYPE 3
-
-#define SPEAKER_PIN 46
-#define LED_SCREEN_CLK_PIN 48
-#define LED_SCREEN_DIO_PIN 49
-
-#define ELECTRIC_EXPLOSION_RELAY_PIN 39
-#define DEFUSE_BUTTON_PIN A1
-#define PLANT_BUTTON_PIN A0
-#define DEFUSE_BUTTON_LED_PIN 37
-#define PLANT_BUTTON_LED_PIN 36
-
-// const char NO_KEY = '\0';
-
-const byte ROWS = 4; //four rows
-const byte COLS = 3; //three columns
-char keys[ROWS][COLS] = {
-    {'1', '2', '3'},
-    {'4', '5', '6'},
-    {'7', '8', '9'},
-    {'*', '0', '#'}};
-byte rowPins[ROWS] = {41, 38, 42, 40}; //connect to the row pinouts of the keypad
-byte colPins[COLS] = {47, 45, 43};     //connect to the column pinouts of the keypad
-
-Keypad keypad = Keypad(makeKeymap(keys), rowPins, colPins, ROWS, COLS);
-
-#if LED_DISPLAY_CONNECTED
-TM1637 led4DigitDisplay(LED_SCREEN_CLK_PIN, LED_SCREEN_DIO_PIN);
-#endif
-
-TMRpcm audio; // create an object for use in this sketch
-Ticker beepBombTicker(beepBomb, 3000, 0, MILLIS);
-Ticker updateGameTimeTicker(updateGameTime, 1000, 0, MILLIS);
-Ticker defusingTicker(defusingCallback, 1000, 0, MILLIS);
-Ticker plantingTicker(plantingCallback, 1000, 0, MILLIS);
-Ticker explodingTicker(explodingCallback, 1000, 0, MILLIS);
-Ticker bombLedTicker(bombLedCallback, 250, 0, MILLIS);
-Ticker defuseLedTicker(defuseLedCallback, 250, 0, MILLIS);
-
-// Declaration for an SSD1306 display connected to I2C (SDA, SCL pins)
-SSD1306AsciiAvrI2c display;
-
 MenuLevel menuLevel = MAIN;
 Runtime runlevel;
 boolean bombBeep = false;
@@ -92,126 +38,201 @@ uint8_t gameLengthMinutes;
 uint8_t defusingTimeLengthSeconds;
 uint8_t plantingTimeLengthSeconds;
 uint8_t explosionTimeLengthMinutes;
-String defuseCode;
 
-long millisGameFinish;
-long millisDefuseFinish;
-long millisPlantingFinish;
-long millisExplosionFinish;
+Countdown gameCountdown;
+Countdown defuseCountdown;
+Countdown plantingCountdown;
+Countdown explosionCountdown;
 
 uint8_t defuseButtonPushed = 0;
 uint8_t plantButtonPushed = 0;
 boolean sdCardInitiated = false;
 
-boolean plantButtonLedOn = false;
-boolean defuseButtonLedOn = false;
+const WizardStep SEARCH_DESTROY_STEPS[] PROGMEM = {
+    {WIZARD_NUMBER, &SCREEN_BOMB_TIME_PROMPT, &explosionTimeLengthMinutes, 1, MAX_SETTING_MINUTES},
+    {WIZARD_NUMBER, &SCREEN_DEFUSE_TIME_PROMPT, &defusingTimeLengthSeconds, 1, MAX_SETTING_SECONDS},
+    {WIZARD_CONFIRM, &SCREEN_START_GAME_PROMPT, NULL},
+    {WIZARD_COUNTDOWN, &SCREEN_STARTING_GAME, NULL},
+    {WIZARD_DONE, NULL, NULL}};
+
+const WizardStep SABOTAGE_STEPS[] PROGMEM = {
+    {WIZARD_NUMBER, &SCREEN_GAME_LENGTH_PROMPT, &gameLengthMinutes, 1, MAX_SETTING_MINUTES},
+    {WIZARD_NUMBER, &SCREEN_PLANT_TIME_PROMPT, &plantingTimeLengthSeconds, 1, MAX_SETTING_SECONDS},
+    {WIZARD_NUMBER, &SCREEN_BOMB_TIME_PROMPT, &explosionTimeLengthMinutes, 1, MAX_SETTING_MINUTES},
+    {WIZARD_NUMBER, &SCREEN_DEFUSE_TIME_PROMPT, &defusingTimeLengthSeconds, 1, MAX_SETTING_SECONDS},
+    {WIZARD_CONFIRM, &SCREEN_START_GAME_PROMPT, NULL},
+    {WIZARD_COUNTDOWN, &SCREEN_STARTING_GAME, NULL},
+    {WIZARD_DONE, NULL, NULL}};
+
+// A preset only needs the start countdown
+const WizardStep QUICK_START_STEPS[] PROGMEM = {
+    {WIZARD_COUNTDOWN, &SCREEN_STARTING_GAME, NULL},
+    {WIZARD_DONE, NULL, NULL}};
+
+const Cue TIME_OVER_CUES[] PROGMEM = {
+    CUE_SCREEN(&SCREEN_TIME_OVER),
+    CUE_WAIT(2500),
+    CUE_SOUND(SOUND_COUNTER_WIN),
+    CUE_CALL(finishRound),
+    CUE_END()};
+
+const Cue DEFUSED_CUES[] PROGMEM = {
+    CUE_SOUND(SOUND_C4_DISARMED),
+    CUE_WAIT(250),
+    CUE_SCREEN(&SCREEN_COUNTER_WIN),
+    CUE_SOUND(SOUND_BOMB_DEFUSED),
+    CUE_WAIT(2500),
+    CUE_SOUND(SOUND_COUNTER_WIN),
+    CUE_CALL(finishRound),
+    CUE_END()};
+
+const Cue EXPLODED_CUES[] PROGMEM = {
+    CUE_SCREEN(&SCREEN_TERRORIST_WIN),
+    CUE_SOUND(SOUND_EXPLOSION),
+    CUE_WAIT(3000),
+    CUE_SOUND(SOUND_TERRORIST_WIN),
+    CUE_CALL(finishRound),
+    CUE_END()};
+
+const Cue PLANTED_CUES[] PROGMEM = {
+    CUE_SCREEN(&SCREEN_BOMB_PLANTED),
+    CUE_SOUND(SOUND_C4_PLANT),
+    CUE_WAIT(160),
+    CUE_SOUND(SOUND_BOMB_PLANTED),
+    CUE_END()};
+
+const Cue SEARCH_DESTROY_START_CUES[] PROGMEM = {
+    CUE_SCREEN(&SCREEN_BOMB_PLANTED),
+    CUE_SOUND(SOUND_BOMB_PLANTED),
+    CUE_WAIT(1500),
+    CUE_CALL(startBombCountdown),
+    CUE_END()};
+
+// Relay, smoke and strobe on entering a runlevel, per game mode
+const PulseTrigger SEARCH_DESTROY_OUTPUTS[] PROGMEM = {
+    {EXPLODED, HAL_OUTPUT_RELAY, {0, 1000, 0, 1}},
+    {EXPLODED, HAL_OUTPUT_SMOKE, {250, 6000, 0, 1}},
+    {EXPLODED, HAL_OUTPUT_STROBE, {0, 40, 60, 60}},
+    {DEFUSED, HAL_OUTPUT_STROBE, {0, 40, 460, 6}},
+    PULSE_TRIGGERS_END()};
+
+const PulseTrigger SABOTAGE_OUTPUTS[] PROGMEM = {
+    {EXPLODED, HAL_OUTPUT_RELAY, {0, 1000, 0, 1}},
+    {EXPLODED, HAL_OUTPUT_SMOKE, {250, 6000, 0, 1}},
+    {EXPLODED, HAL_OUTPUT_STROBE, {0, 40, 60, 60}},
+    {DEFUSED, HAL_OUTPUT_STROBE, {0, 40, 460, 6}},
+    {TIME_OVER, HAL_OUTPUT_STROBE, {0, 40, 460, 6}},
+    PULSE_TRIGGERS_END()};
 
 void setup()
 {
   blink(1, 150);
-  pinMode(LED_BUILTIN, OUTPUT);
-#if DEBUG
+  halPinMode(LED_BUILTIN, OUTPUT);
+#if DEBUG || TELEMETRY || LOG_TO_SERIAL
   Serial.begin(115200);
-  Serial.println(F("Setup"));
 #endif
+  logWaitForRoom(true);
+  LOG_INFO(SETUP, LOG_SETUP);
+  if (schedulerRefused() > 0)
+  {
+    LOG_ERROR(SETUP, LOG_SCHEDULER_FULL, schedulerRefused(), SCHEDULER_CAPACITY);
+  }
 
-  pinMode(LED_BUILTIN, OUTPUT);
-  pinMode(DEFUSE_BUTTON_PIN, INPUT);
-  pinMode(PLANT_BUTTON_PIN, INPUT);
-  pinMode(DEFUSE_BUTTON_LED_PIN, OUTPUT);
-  pinMode(PLANT_BUTTON_LED_PIN, OUTPUT);
-  pinMode(ELECTRIC_EXPLOSION_RELAY_PIN, OUTPUT);
-
-  digitalWrite(ELECTRIC_EXPLOSION_RELAY_PIN, LOW);
-
-#if DISPLAY_CONNECTED
+  halPinMode(LED_BUILTIN, OUTPUT);
+  buttonsBegin();
+  keypadBegin();
+  ledEffectsBegin();
+  pulseOutputBegin();
+  presetsBegin();
 
-#if DEBUG
-  Serial.begin(115200);
-  Serial.println(F("Display setup"));
+#if LOG_LEVEL_SETUP >= LOG_LEVEL_INFO
+  halPinBenchmark();
 #endif
 
-  display.begin(&Adafruit128x64, 0x3C);
-  display.setFont(Adafruit5x7);
+#if DISPLAY_CONNECTED
+  LOG_INFO(SETUP, LOG_DISPLAY_SETUP);
+  halOledBegin();
+  screenBegin();
 #endif
 
   initSdCard();
-  audio.speakerPin = SPEAKER_PIN;
+  halAudioBegin();
 
-#if LED_DISPLAY_CONNECTED
-
-#if DEBUG
-  Serial.begin(115200);
-  Serial.println(F("4 Digit LED setup"));
+#if INPUT_TRACE
+#if INPUT_TRACE_REPLAY
+  inputTraceReplayBoot(INPUT_TRACE_LAST_BOOT);
+#endif
+  inputTraceBegin();
 #endif
 
-  led4DigitDisplay.set();
-  led4DigitDisplay.init();
+#if LED_DISPLAY_CONNECTED
+  LOG_INFO(SETUP, LOG_LED_SETUP);
+  ledDisplayBegin();
 #endif
 
-#if DEBUG
-  Serial.print(F("Free memory: "));
-  Serial.println(freeMemory(), DEC);
+  LOG_INFO(SETUP, LOG_FREE_MEMORY, halFreeMemory());
+  logWaitForRoom(false);
+
+  PROFILE_BEGIN();
+
+#if TELEMETRY
+  schedulerStart(telemetryTimer);
 #endif
 
-  delay(150);
-  playSound("enemydown-15db.wav");
-  runlevel = SETTINGS;
+  halDelay(150);
+  playSound(SOUND_ENEMY_DOWN);
+  setRunlevel(SETTINGS);
   printMainMenu();
 }
 
 void loop()
 {
-  char read = getInputIfAvailable();
-  if (read != NO_KEY)
+  PROFILE_ITERATION_START();
+  pulseOutputFeed();
+
+  keypadUpdate();
+  PROFILE_MARK(SECTION_KEYPAD);
+
+  KeyEvent keyEvent;
+  while (nextKeyEvent(keyEvent))
   {
-    Serial.print(read);
-    applyAction(read);
+    handleKeyEvent(keyEvent);
   }
+  PROFILE_MARK(SECTION_ACTION);
 
   updateButtonStatuses();
+  PROFILE_MARK(SECTION_BUTTONS);
 
-  beepBombTicker.update();
-  updateGameTimeTicker.update();
-  defusingTicker.update();
-  explodingTicker.update();
-  plantingTicker.update();
-  bombLedTicker.update();
-  defuseLedTicker.update();
+  schedulerUpdate();
+  PROFILE_MARK(SECTION_SCHEDULER);
 
-  switch (runlevel)
-  {
-  case TIME_OVER:
-
-    displayLinesInDisplay(F(""), 0, F("TIME OVER"), 10, F(""), 20, F(""), 30);
-    delay(2500);
-    playSound("ctwin-15.wav");
-    runlevel = END;
-    break;
+  halAudioUpdate();
+  PROFILE_MARK(SECTION_AUDIO);
 
-  case DEFUSED:
-    displayLinesInDisplay(F(""), 0, F("Counter"), 30, F("WIN"), 50, F(""), 30);
-    playSound("bombdef-15db.wav");
-    delay(2500);
-    playSound("ctwin-15.wav");
+  cueUpdate();
+  wizardUpdate();
+  PROFILE_MARK(SECTION_CUES);
 
-    runlevel = END;
-    break;
+  PROFILE_ITERATION_END();
 
-  case EXPLODED:
-    digitalWrite(ELECTRIC_EXPLOSION_RELAY_PIN, HIGH);
-    displayLinesInDisplay(F(""), 0, F("Terrorist"), 10, F("WIN"), 50, F(""), 30);
-    playSound("new_bomb_explosion-5db.wav");
-    delay(3000);
-    playSound("terwin-15.wav");
+#if IDLE_BETWEEN_EVENTS
+  idleUntilNextEvent();
+#endif
+}
 
-    runlevel = END;
-    break;
+void idleUntilNextEvent()
+{
+  unsigned long idleMillis = schedulerMillisUntilNext();
+  idleMillis = min(idleMillis, keypadMillisUntilNext());
+  idleMillis = min(idleMillis, cueMillisUntilNext());
+  idleMillis = min(idleMillis, wizardMillisUntilNext());
+#if INPUT_TRACE
+  idleMillis = min(idleMillis, inputTraceMillisUntilNext());
+#endif
 
-  case END:
-    digitalWrite(PLANT_BUTTON_LED_PIN, LOW);
-    digitalWrite(DEFUSE_BUTTON_LED_PIN, LOW);
-    break;
+  if (idleMillis > 0)
+  {
+    halIdle(idleMillis);
   }
 }
 
@@ -219,137 +240,175 @@ void initSdCard()
 {
 
 #if SD_CARD_CONNECTED
+  LOG_INFO(SETUP, LOG_SD_SETUP);
 
-#if DEBUG
-  Serial.begin(115200);
-  Serial.println(F("SD card setup"));
-#endif
-
-  if (!sd.begin(SS))
+  if (!halSdBegin())
   {
     blink(3, 150);
-#if DEBUG
-    Serial.println(F("SD error"));
-
-#endif
+    LOG_ERROR(SETUP, LOG_SD_ERROR);
     return;
   }
   else
   {
 
     sdCardInitiated = true;
+    gameLogBegin();
   }
 
 #endif
 }
 
-void updateButtonStatuses()
+// The keypad and buttons go through the input trace, which records them or
+// stands in for them during a replay
+boolean nextKeyEvent(KeyEvent &event)
 {
-
-  uint8_t defuseValue = digitalRead(DEFUSE_BUTTON_PIN);
-  if (defuseValue != defuseButtonPushed)
+#if INPUT_TRACE
+  if (inputTraceReplaying())
   {
-    defuseButtonPushed = defuseValue;
-
-    if (defuseButtonPushed)
+    while (keypadPoll(event))
     {
-      defusingActionTrigger();
-    }
-    else
-    {
-      cancelDefusingActionTrigger();
     }
+    return inputTraceNextKey(event);
   }
 
-  uint8_t planting = digitalRead(PLANT_BUTTON_PIN);
-  if (planting != plantButtonPushed)
+  if (!keypadPoll(event))
   {
-    plantButtonPushed = planting;
+    return false;
+  }
+  inputTraceRecordKey(event);
+  return true;
+#else
+  return keypadPoll(event);
+#endif
+}
 
-    if (plantButtonPushed)
-    {
-      plantBombActionTrigger();
-    }
-    else
+boolean nextButtonEvent(ButtonEvent &event)
+{
+#if INPUT_TRACE
+  if (inputTraceReplaying())
+  {
+    while (buttonsPoll(event))
     {
-      cancelPlantingBombActionTrigger();
     }
+    return inputTraceNextButton(event);
+  }
+
+  if (!buttonsPoll(event))
+  {
+    return false;
   }
+  inputTraceRecordButton(event);
+  return true;
+#else
+  return buttonsPoll(event);
+#endif
 }
 
-char getInputIfAvailable()
+void updateButtonStatuses()
 {
-  // if (Serial.available() > 0)
-  // {
-  //   char read = Serial.read();
-  //   Serial.print("Keypad key pressed: ");
-  //   Serial.println(read);
-  //   return read;
-  // }
-
-  if (keypad.getKeys())
+  ButtonEvent event;
+  while (nextButtonEvent(event))
   {
-    for (uint8_t i = 0; i < LIST_MAX; i++) // Scan the whole key list.
+    if (event.button == HAL_BUTTON_DEFUSE)
     {
-      if (keypad.key[i].stateChanged) // Only find keys that have changed state.
+      defuseButtonPushed = event.pressed;
+
+      if (defuseButtonPushed)
       {
-        if (keypad.key[i].kstate == PRESSED)
-        {
-#if DEBUG
-          Serial.print("Keypad key pressed: ");
-          Serial.println(keypad.key[i].kchar);
-#endif
+        defusingActionTrigger(event.atMillis);
+      }
+      else
+      {
+        cancelDefusingActionTrigger();
+      }
+    }
+    else
+    {
+      plantButtonPushed = event.pressed;
 
-          return keypad.key[i].kchar;
-        }
+      if (plantButtonPushed)
+      {
+        plantBombActionTrigger(event.atMillis);
+      }
+      else
+      {
+        cancelPlantingBombActionTrigger();
       }
     }
   }
-
-  return NO_KEY;
 }
 
-void printMainMenu()
+static void handleKeyPress(char key)
 {
-  menuLevel = MAIN;
-  displayLinesInDisplay(F("1.Search &"), 0, F("Destroy"), 15, F(""), 50, F("2.Sabotage"), 0);
+  LOG_INFO(KEYPAD, LOG_KEY_PRESSED, key);
+  applyAction(key);
 }
 
-void bigTextLine(String line, uint8_t x, uint8_t y)
+void handleKeyEvent(const KeyEvent &event)
 {
-#if DISPLAY_CONNECTED
-  display.set2X();
-  display.setCursor(x, y);
-  display.println(line);
+#if LOOP_PROFILER
+  // The press of the dump hold key is held back until the key comes up or
+  // another key joins it, so asking for a dump does not also confirm a
+  // prompt or start a round. Held back, it acts on release instead.
+  static boolean dumpHoldPressed;
+  if (loopProfilerDumpRequested(event))
+  {
+    dumpHoldPressed = false;
+    loopProfilerDump();
+    return;
+  }
+  if (event.type == KEY_PRESS && event.key == LOOP_PROFILER_DUMP_HOLD_KEY)
+  {
+    dumpHoldPressed = true;
+    return;
+  }
+  if (dumpHoldPressed && (event.type == KEY_CHORD || (event.type == KEY_RELEASE && event.key == LOOP_PROFILER_DUMP_HOLD_KEY)))
+  {
+    dumpHoldPressed = false;
+    handleKeyPress(LOOP_PROFILER_DUMP_HOLD_KEY);
+  }
 #endif
 
-#if DEBUG
-  Serial.println(line);
-#endif
+  if (event.type == KEY_CHORD && event.heldKey == PRESET_SAVE_HOLD_KEY)
+  {
+    saveLastUsedAsPreset(event.key);
+    return;
+  }
+
+  // The menus and the game only act on presses otherwise
+  if (event.type != KEY_PRESS)
+  {
+    return;
+  }
+
+  handleKeyPress(event.key);
 }
 
-void smallTextLine(String line, uint8_t x, uint8_t y)
+void printMainMenu()
 {
-#if DISPLAY_CONNECTED
-  display.set1X();
-  display.setCursor(x, y);
-  display.println(line);
-#endif
-
-#if DEBUG
-  Serial.println(line);
-#endif
+  menuLevel = MAIN;
+  displayScreen(&SCREEN_MAIN_MENU);
 }
 
 void applyAction(char action)
 {
 
-#if DEBUG
-  Serial.print("Applying action: ");
-  Serial.println(action);
-#endif
+  LOG_INFO(KEYPAD, LOG_ACTION, action);
+
+  playSound(SOUND_KEY_CLICK);
+
+  if (wizardActive())
+  {
+    wizardKey(action);
+    return;
+  }
+
+  if (runlevel == TIME_OVER || runlevel == DEFUSED || runlevel == EXPLODED || runlevel == END)
+  {
+    applyRoundOverAction(action);
+    return;
+  }
 
-  playSound("nvg_off-15db.wav");
   switch (menuLevel)
   {
   case MAIN:
@@ -370,195 +429,118 @@ void applyMainMenuLevelAction(char action)
   {
   case '1':
     menuLevel = SEARCH_DESTROY;
-    requestBombExplosionTime();
-    requestDefuseTime();
-    triggerGameStart();
-    runlevel = PLANTED;
-    showBombPlantedLinesInDisplay();
-    bombBeep = true;
-    playSound("bombpl-15db.wav");
-    delay(1500);
-    millisExplosionFinish = (explosionTimeLengthMinutes * 60L * 1000L) + millis();
-    explodingTicker.start();
-    beepBombTicker.start();
+    wizardStart(SEARCH_DESTROY_STEPS, startSearchDestroy, startNextRound);
     break;
 
   case '2':
     menuLevel = SABOTAGE;
-    requestGameTime();
-    requestPlantingTime();
-    requestBombExplosionTime();
-    requestDefuseTime();
-    triggerGameStart();
-
-    runlevel = PLAYING;
-
-    millisGameFinish = (gameLengthMinutes * 60L * 1000L) + millis();
-    bombBeep = true;
-    updateGameTimeTicker.start();
-    beepBombTicker.start();
-    showGameStartedLinesInDisplay();
+    wizardStart(SABOTAGE_STEPS, startSabotage, startNextRound);
+    break;
+
+  case '3':
+    quickStartLastUsed();
+    break;
+
+  case '4':
+  case '5':
+  case '6':
+  case '7':
+  case '8':
+  case '9':
+    quickStartPreset(action - '4');
     break;
   }
 }
 
-void requestGameTime()
+GameSettings currentSettings()
 {
-  displayLinesInDisplay(F("Game Length"), 0, F("in minutes?"), 0, F("#-> OK"), 0, F("*-> Cancel"), 0);
-  gameLengthMinutes = (uint8_t)awaitForInput().toInt();
+  GameSettings settings;
+  settings.mode = menuLevel;
+  settings.gameLengthMinutes = gameLengthMinutes;
+  settings.plantingTimeLengthSeconds = plantingTimeLengthSeconds;
+  settings.explosionTimeLengthMinutes = explosionTimeLengthMinutes;
+  settings.defusingTimeLengthSeconds = defusingTimeLengthSeconds;
+  return settings;
 }
 
-void requestDefuseTime()
+// Skips the prompts: the settings are taken as they are and only the start
+// countdown runs, with the name of the preset on the first line
+void quickStart(const GameSettings &settings, const char *name)
 {
-  displayLinesInDisplay(F("Defuse time"), 0, F("in seconds?"), 0, F("#-> OK"), 0, F("*-> Cancel"), 0);
-  defusingTimeLengthSeconds = (uint8_t)awaitForInput().toInt();
-}
+  menuLevel = (MenuLevel)settings.mode;
+  gameLengthMinutes = settings.gameLengthMinutes;
+  plantingTimeLengthSeconds = settings.plantingTimeLengthSeconds;
+  explosionTimeLengthMinutes = settings.explosionTimeLengthMinutes;
+  defusingTimeLengthSeconds = settings.defusingTimeLengthSeconds;
 
-void requestPlantingTime()
-{
-  displayLinesInDisplay(F("Bomb Plant"), 0, F("in seconds?"), 0, F("#-> OK"), 0, F("*-> Cancel"), 0);
-  plantingTimeLengthSeconds = (uint8_t)awaitForInput().toInt();
+  wizardStart(QUICK_START_STEPS, menuLevel == SABOTAGE ? startSabotage : startSearchDestroy, startNextRound);
+#if DISPLAY_CONNECTED
+  screenShowLine(0, name, 0);
+#endif
 }
 
-void requestDefuseCode()
+void quickStartLastUsed()
 {
-  displayLinesInDisplay(F("Defusing"), 0, F("code?"), 0, F("#-> OK"), 0, F("*-> Cancel"), 0);
-  defuseCode = awaitForInput();
+  GameSettings settings;
+  if (presetLoadLastUsed(settings))
+  {
+    LOG_INFO(GAME, LOG_QUICK_START_LAST_USED);
+    quickStart(settings, "Last game");
+  }
 }
 
-void requestBombExplosionTime()
+void quickStartPreset(uint8_t index)
 {
-  displayLinesInDisplay(F("Bomb time"), 0, F("in minutes?"), 0, F("#-> OK"), 0, F("*-> Cancel"), 0);
-  explosionTimeLengthMinutes = (uint8_t)awaitForInput().toInt();
+  GameSettings settings;
+  char name[PRESET_NAME_CHARS + 1];
+  presetLoad(index, settings, name);
+  LOG_INFO(GAME, LOG_QUICK_START_PRESET, index + 4);
+  quickStart(settings, name);
 }
 
-void triggerGameStart()
+// Hold PRESET_SAVE_HOLD_KEY and press 4 to 9 in the main menu
+void saveLastUsedAsPreset(char key)
 {
-  displayLinesInDisplay(F("Start game?"), 0, F(""), 0, F("#-> OK"), 0, F("*-> Cancel"), 0);
-  awaitOkCancel();
-  countdown();
-
-  bombLedTicker.start();
-  defuseLedTicker.start();
-
-#if DEBUG
-  Serial.println(freeMemory(), DEC);
-
-  Serial.print(F("Millis game finish: "));
-  Serial.println(millisGameFinish);
-
-  Serial.print(F("Game length "));
-  Serial.println(gameLengthMinutes);
-
-  Serial.print(F("(gameLength * 60) "));
-  Serial.println((gameLengthMinutes * 60));
-
-#endif
+  GameSettings settings;
+  if (runlevel != SETTINGS || menuLevel != MAIN || wizardActive() || key < '4' || key > '9' || !presetLoadLastUsed(settings))
+  {
+    return;
+  }
 
-  playSound("com_go-15.wav");
+  char name[PRESET_NAME_CHARS + 1] = "Preset ";
+  name[7] = key;
+  name[8] = '\0';
+  presetSave(key - '4', settings, name);
+  LOG_INFO(GAME, LOG_PRESET_SAVED, key - '0');
+  playSound(SOUND_KEY_CLICK);
 }
 
-String awaitForInput()
+void startGame()
 {
-  String input;
-  do
-  {
-    char read = getInputIfAvailable();
-    if (read != NO_KEY)
-    {
-
-      playSound("nvg_off-15db.wav");
-
-      if (read == '*')
-      {
-        resetFunc();
-      }
-      else if (read == '#')
-      {
-        if (input.length() > 0)
-        {
-          Serial.print(F("Input read: "));
-          Serial.println(input);
-          clearLedDisplay();
-          return input;
-        }
-      }
-      else
-      {
-        input += read;
-        displayLedNumber(input.toFloat());
-      }
-    }
-
-  } while (true);
+  LOG_INFO(GAME, LOG_GAME_START, halFreeMemory(), gameLengthMinutes, gameCountdown.end.atMillis);
+  presetSaveLastUsed(currentSettings());
+  gameLogRecord(GAME_LOG_ROUND_START, halMillis(), menuLevel);
+  playSound(SOUND_GO);
 }
 
-void awaitOkCancel()
+void startSearchDestroy()
 {
-  do
-  {
-    char read = getInputIfAvailable();
-    if (read != NO_KEY)
-    {
-      playSound("nvg_off-15db.wav");
-
-      if (read == '*')
-      {
-        resetFunc();
-      }
-      else if (read == '#')
-      {
-        return;
-      }
-    }
-
-  } while (true);
+  startGame();
+  setRunlevel(PLANTED);
+  bombBeep = true;
+  cueStart(SEARCH_DESTROY_START_CUES);
 }
 
-void countdown()
+void startSabotage()
 {
+  countdownStart(gameCountdown, halMillis(), gameLengthMinutes, 0);
+  startGame();
+  setRunlevel(PLAYING);
 
-#if DEBUG
-  Serial.println(F("Starting game"));
-
-#endif
-
-  unsigned long countdownTime = 10000;
-  unsigned long initialMillis = millis();
-  unsigned long endMillis = initialMillis + countdownTime;
-  uint8_t displayedSecond = 10;
-  uint8_t currentSecond;
-  boolean finished = false;
-
-  displayLinesInDisplay(F(""), 0, F("Starting"), 10, F("game"), 40, F(""), 0);
-  while (!finished)
-  {
-
-    if (millis() - initialMillis > countdownTime)
-    {
-      return;
-    }
-
-    int currentSecond = (endMillis - millis()) / 1000;
-
-    if (displayedSecond != currentSecond)
-    {
-      displayedSecond = currentSecond;
-      displayLedCountdown(currentSecond);
-    }
-
-    if (currentSecond == 0)
-    {
-      finished = true;
-    }
-  }
-
-#if DISPLAY_CONNECTED
-  display.clear();
-#endif
-
-  bigTextLine(F(""), 0, 0);
-  bigTextLine(F("GO!"), 55, 32);
+  bombBeep = true;
+  schedulerStart(updateGameTimeTimer);
+  schedulerStart(beepBombTimer);
+  showGameStartedLinesInDisplay();
 }
 
 void beepBomb()
@@ -567,7 +549,7 @@ void beepBomb()
   (runlevel == PLANTED 
   || (menuLevel == SABOTAGE && runlevel == PLAYING)))
   {
-    tone(SPEAKER_PIN, 4186, 120); // C8
+    halTone(4186, 120); // C8
   }
 }
 
@@ -575,60 +557,74 @@ void updateGameTime()
 {
   if (runlevel == PLAYING)
   {
-    unsigned long timeLeft = (millisGameFinish - millis()) / 1000L;
-
-#if DEBUG
-    Serial.print(F("timeLeft: "));
-    Serial.print(timeLeft);
-    Serial.print(F("millisGameFinish:"));
-    Serial.println(millisGameFinish);
-    Serial.print(F(" millis():"));
-    Serial.println(millis());
-#endif
-
-    if (timeLeft > 0)
+    if (countdownUpdate(gameCountdown, halMillis()))
     {
-      displayLedCountdown(timeLeft);
+      displayLedCountdown(gameCountdown.minutes, gameCountdown.seconds);
     }
     else
     {
       stopTimers();
-      runlevel = TIME_OVER; // The game is over¨
+      setRunlevel(TIME_OVER); // The game is over¨
+      gameLogRecord(GAME_LOG_TIME_OVER, halMillis(), 0);
+      cueStart(TIME_OVER_CUES);
     }
   }
 }
 
-void displayLinesInDisplay(String firstLine, uint8_t firstLineX, String secondLine, uint8_t secondLineX, String thirdLine, uint8_t thirdLineX, String forthLine, uint8_t forthLineX)
+void displayScreen(const ScreenDescriptor *screen)
 {
+#if LOG_LEVEL_DISPLAY >= LOG_LEVEL_INFO
+  int freeMemoryBefore = halFreeMemory();
+  unsigned long allocationsBefore = memoryAllocations();
+#endif
+
+#if DISPLAY_CONNECTED
+  screenShow_P(screen);
+#endif
+
+#if LOG_LEVEL_DISPLAY >= LOG_LEVEL_INFO
 #if DISPLAY_CONNECTED
-  display.clear();
+  const ScreenStats &stats = screenStats();
+  LOG_INFO(DISPLAY, LOG_SCREEN_BYTES, stats.lastBytes, stats.lastFullRedrawBytes, stats.lastMicros);
 #endif
 
-  bigTextLine(firstLine, firstLineX, 0);
-  bigTextLine(secondLine, secondLineX, 16);
-  bigTextLine(thirdLine, thirdLineX, 32);
-  bigTextLine(forthLine, forthLineX, 48);
+  LOG_INFO(DISPLAY, LOG_SCREEN_MEMORY, memoryAllocations() - allocationsBefore, freeMemoryBefore, halFreeMemory());
+  LOG_INFO(DISPLAY, LOG_HEAP_HIGH_WATER, memoryHeapHighWater());
+#endif
 }
 
-void displayLedCountdown(long totalSeconds)
+#if LED_DISPLAY_CONNECTED
+static void showLedDigits(const int8_t digits[LED_DIGITS], boolean colon)
 {
-  uint8_t minutes = totalSeconds / 60;
-  uint8_t seconds = totalSeconds % 60;
+  ledDisplayShow(digits, colon);
 
-#if DEBUG
-  Serial.print(F("Led countdown: "));
-  Serial.print(minutes);
-  Serial.print(F(":"));
-  Serial.println(seconds);
+  const LedDisplayStats &stats = ledDisplayStats();
+  LOG_DEBUG(DISPLAY, LOG_LED_FRAMES, stats.updates, stats.lastMicros, stats.maxMicros);
+}
 #endif
 
+// Splits a value into tens (mod 10) and ones by subtraction, AVR has no
+// divide instruction
+static void splitDigits(uint8_t value, int8_t &tens, int8_t &ones)
+{
+  tens = 0;
+  while (value >= 10)
+  {
+    value -= 10;
+    tens = tens == 9 ? 0 : tens + 1;
+  }
+  ones = value;
+}
+
+void displayLedCountdown(uint8_t minutes, uint8_t seconds)
+{
+  LOG_DEBUG(DISPLAY, LOG_LED_COUNTDOWN, minutes, seconds);
+
 #if LED_DISPLAY_CONNECTED
-  led4DigitDisplay.clearDisplay();
-  led4DigitDisplay.point(1);
-  led4DigitDisplay.display(3, seconds % 10);
-  led4DigitDisplay.display(2, seconds / 10 % 10);
-  led4DigitDisplay.display(1, minutes % 10);
-  led4DigitDisplay.display(0, minutes / 10 % 10);
+  int8_t digits[LED_DIGITS];
+  splitDigits(minutes, digits[0], digits[1]);
+  splitDigits(seconds, digits[2], digits[3]);
+  showLedDigits(digits, true);
 #endif
 }
 
@@ -636,38 +632,33 @@ void displayLedNumber(long number)
 {
 
 #if LED_DISPLAY_CONNECTED
-  led4DigitDisplay.clearDisplay();
-  led4DigitDisplay.point(0);
-  led4DigitDisplay.display(3, number % 10);
+  int8_t digits[LED_DIGITS] = {LED_BLANK, LED_BLANK, LED_BLANK, (int8_t)(number % 10)};
 
   if (number > 9)
   {
-    led4DigitDisplay.display(2, number / 10 % 10);
+    digits[2] = number / 10 % 10;
   }
 
   if (number > 99)
   {
-    led4DigitDisplay.display(1, number / 100 % 10);
+    digits[1] = number / 100 % 10;
   }
 
   if (number > 999)
   {
-    led4DigitDisplay.display(0, number / 1000 % 10);
+    digits[0] = number / 1000 % 10;
   }
 
+  showLedDigits(digits, false);
 #endif
 
-#if DEBUG
-  Serial.print(F("Led number: "));
-  Serial.println(number);
-#endif
+  LOG_DEBUG(DISPLAY, LOG_LED_NUMBER, number);
 }
 
 void clearLedDisplay()
 {
 #if LED_DISPLAY_CONNECTED
-  led4DigitDisplay.point(0);
-  led4DigitDisplay.clearDisplay();
+  ledDisplayClear();
 #endif
 }
 
@@ -675,17 +666,16 @@ void defusingCallback()
 {
   if (runlevel == DEFUSING)
   {
-    unsigned long timeLeft = (millisDefuseFinish - millis()) / 1000L;
-    if (timeLeft > 0)
+    if (countdownUpdate(defuseCountdown, halMillis()))
     {
-      displayLedCountdown(timeLeft);
+      displayLedCountdown(defuseCountdown.minutes, defuseCountdown.seconds);
     }
     else
     {
-      playSound("c4_disarmed-15db.wav");
-      delay(250);
-      runlevel = DEFUSED; // The game is over
+      setRunlevel(DEFUSED); // The game is over
+      gameLogRecord(GAME_LOG_DEFUSED, halMillis(), 0);
       stopTimers();
+      cueStart(DEFUSED_CUES);
     }
   }
 }
@@ -694,34 +684,21 @@ void plantingCallback()
 {
   if (runlevel == PLANTING)
   {
-    unsigned long timeLeft = (millisPlantingFinish - millis()) / 1000L;
-
-#if DEBUG
-    Serial.print(F("planting timeleft "));
-    Serial.println(timeLeft);
-    Serial.print(F("millisPlantingFinish  "));
-    Serial.println(millisPlantingFinish);
-#endif
-
-    if (timeLeft > 0)
+    if (countdownUpdate(plantingCountdown, halMillis()))
     {
-      displayLedCountdown(timeLeft);
+      displayLedCountdown(plantingCountdown.minutes, plantingCountdown.seconds);
     }
     else
     {
-      playSound("c4_plant-15db.wav");
-      delay(160);
-      runlevel = PLANTED;
-      millisExplosionFinish = millis() + (explosionTimeLengthMinutes * 60L * 1000L);
-      showBombPlantedLinesInDisplay();
-
-#if DEBUG
-      Serial.print(F("millisExplosionFinish "));
-      Serial.println(millisExplosionFinish);
-#endif
-      plantingTicker.stop();
-      explodingTicker.start();
-      playSound("bombpl-15db.wav");
+      setRunlevel(PLANTED);
+      gameLogRecord(GAME_LOG_PLANTED, halMillis(), explosionTimeLengthMinutes);
+      countdownStart(explosionCountdown, halMillis(), explosionTimeLengthMinutes, 0);
+      cueStart(PLANTED_CUES);
+
+      LOG_INFO(GAME, LOG_PLANTED, explosionCountdown.end.atMillis);
+      schedulerStop(plantingTimer);
+      schedulerStart(explodingTimer);
+      updateButtonLeds();
     }
   }
 }
@@ -730,195 +707,248 @@ void explodingCallback()
 {
   if (runlevel == PLANTED)
   {
+    boolean ticking = countdownUpdate(explosionCountdown, halMillis());
+    schedulerSetInterval(beepBombTimer, countdownUrgencyMillis(explosionCountdown.secondsLeft));
 
-    int timeLeft = (millisExplosionFinish - millis()) / 1000L;
-
-#if DEBUG
-    Serial.print(F("millisExplosionFinish "));
-    Serial.println(millisExplosionFinish);
-
-    Serial.print(F("timeLeft "));
-    Serial.println(timeLeft);
-#endif
-
-    if (timeLeft >= 15 && timeLeft <= 30)
-    {
-      beepBombTicker.interval(1000);
-    }
-    else if (timeLeft > 5 && timeLeft <= 15)
-    {
-      beepBombTicker.interval(500);
-    }
-    else if (timeLeft <= 5)
+    if (ticking)
     {
-      beepBombTicker.interval(250);
-    }
-
-    if (timeLeft > 0)
-    {
-      displayLedCountdown(timeLeft);
+      displayLedCountdown(explosionCountdown.minutes, explosionCountdown.seconds);
     }
     else
     {
 
-#if DEBUG
-      Serial.println(F("Exploded"));
-#endif
+      LOG_INFO(GAME, LOG_EXPLODED);
 
-      runlevel = EXPLODED; // The game is over
+      setRunlevel(EXPLODED); // The game is over
+      gameLogRecord(GAME_LOG_EXPLODED, halMillis(), 0);
       stopTimers();
+      cueStart(EXPLODED_CUES);
     }
   }
 }
 
-void bombLedCallback()
+void plantBombActionTrigger(unsigned long pressedAtMillis)
 {
   if (runlevel == PLAYING)
   {
+    LOG_INFO(GAME, LOG_PLANTING);
 
-    if (plantButtonLedOn)
-    {
-      digitalWrite(PLANT_BUTTON_LED_PIN, HIGH);
-#if DEBUG
-      //Serial.println(F("bombLedCallback On"));
-#endif
-    }
-    else
-    {
-      digitalWrite(PLANT_BUTTON_LED_PIN, LOW);
-#if DEBUG
-      //Serial.println(F("bombLedCallback Off"));
-#endif
-    }
-
-    plantButtonLedOn = !plantButtonLedOn;
+    setRunlevel(PLANTING);
+    gameLogRecord(GAME_LOG_PLANTING, pressedAtMillis, plantingTimeLengthSeconds);
+    playSound(SOUND_C4_DISARM);
+    countdownStart(plantingCountdown, pressedAtMillis, 0, plantingTimeLengthSeconds);
+    schedulerStart(plantingTimer);
+    displayScreen(&SCREEN_PLANTING);
   }
 }
 
-void defuseLedCallback()
+void defusingActionTrigger(unsigned long pressedAtMillis)
 {
   if (runlevel == PLANTED)
   {
+    LOG_INFO(GAME, LOG_DEFUSING);
 
-    if (defuseButtonLedOn)
+    setRunlevel(DEFUSING);
+    gameLogRecord(GAME_LOG_DEFUSING, pressedAtMillis, defusingTimeLengthSeconds);
+    // Defusing while Search & Destroy arms cuts the announcement short,
+    // the countdown it was about to start must still run
+    if (!schedulerRunning(explodingTimer))
     {
-#if DEBUG
-      //Serial.println(F("defuseLedCallback ON"));
-#endif
-      digitalWrite(DEFUSE_BUTTON_LED_PIN, HIGH);
+      startBombCountdown();
     }
-    else
-    {
-#if DEBUG
-      //Serial.println(F("defuseLedCallback Off"));
-#endif
+    cueStop(); // A pending "bomb planted" announcement must not cover the defuse
+    playSound(SOUND_C4_DISARM);
+    countdownStart(defuseCountdown, pressedAtMillis, 0, defusingTimeLengthSeconds);
+    showDefusingLinesInDisplay();
+    schedulerStart(defusingTimer);
+  }
+}
 
-      digitalWrite(DEFUSE_BUTTON_LED_PIN, LOW);
-    }
+void showDefusingLinesInDisplay()
+{
+  displayScreen(&SCREEN_DEFUSING);
+}
 
-    defuseButtonLedOn = !defuseButtonLedOn;
-  }
+void showBombPlantedLinesInDisplay()
+{
+  displayScreen(&SCREEN_BOMB_PLANTED);
 }
 
-void plantBombActionTrigger()
+void showGameStartedLinesInDisplay()
 {
-  if (runlevel == PLAYING)
-  {
-    digitalWrite(PLANT_BUTTON_LED_PIN, HIGH);
-    plantButtonLedOn = true;
+  displayScreen(&SCREEN_GAME_RUNNING);
+}
 
-#if DEBUG
-    Serial.println(F("Planting the bomb"));
-#endif
+void cancelDefusingActionTrigger()
+{
+  if (runlevel == DEFUSING)
+  {
+    LOG_INFO(GAME, LOG_DEFUSING_CANCELLED);
 
-    runlevel = PLANTING;
-    playSound("c4_disarm-15db.wav");
-    millisPlantingFinish = millis() + (plantingTimeLengthSeconds * 1000L);
-    plantingTicker.start();
-    displayLinesInDisplay(F("Planting"), 10, F("the bomb"), 20, F("Please"), 30, F("wait"), 40);
+    setRunlevel(PLANTED);
+    gameLogRecord(GAME_LOG_DEFUSING_CANCELLED, halMillis(), 0);
+    schedulerStop(defusingTimer);
+    showBombPlantedLinesInDisplay();
   }
 }
 
-void defusingActionTrigger()
+void cancelPlantingBombActionTrigger()
 {
-  if (runlevel == PLANTED)
+  if (runlevel == PLANTING)
   {
-    digitalWrite(DEFUSE_BUTTON_LED_PIN, HIGH);
-    defuseButtonLedOn = true;
+    LOG_INFO(GAME, LOG_PLANTING_CANCELLED);
 
-#if DEBUG
-    Serial.println(F("Defusing"));
-#endif
+    setRunlevel(PLAYING);
+    gameLogRecord(GAME_LOG_PLANTING_CANCELLED, halMillis(), 0);
+    schedulerStop(plantingTimer);
+    showGameStartedLinesInDisplay();
+  }
+}
 
-    runlevel = DEFUSING;
-    playSound("c4_disarm-15db.wav");
-    millisDefuseFinish = millis() + (defusingTimeLengthSeconds * 1000L);
-    showDefusingLinesInDisplay();
-    defusingTicker.start();
+// The plant LED breathes while a bomb can be planted, the defuse LED
+// flashes with the bomb's urgency while it can be defused, and a held
+// button keeps its LED on
+void updateButtonLeds()
+{
+  switch (runlevel)
+  {
+  case PLAYING:
+    ledEffectBreathe(HAL_BUTTON_PLANT, PLANT_LED_BREATHE_MILLIS);
+    ledEffectOff(HAL_BUTTON_DEFUSE);
+    break;
+  case PLANTING:
+    ledEffectOn(HAL_BUTTON_PLANT);
+    break;
+  case PLANTED:
+    ledEffectOff(HAL_BUTTON_PLANT);
+    if (schedulerRunning(explodingTimer))
+    {
+      long millisLeft = deadlineMillisLeft(explosionCountdown.end, halMillis());
+      ledEffectCountdown(HAL_BUTTON_DEFUSE, millisLeft > 0 ? millisLeft : 0);
+    }
+    else
+    {
+      ledEffectBlink(HAL_BUTTON_DEFUSE, DEFUSE_LED_ARMING_BLINK_MILLIS); // Search & Destroy arming
+    }
+    break;
+  case DEFUSING:
+    ledEffectOn(HAL_BUTTON_DEFUSE);
+    break;
+  default:
+    ledEffectOff(HAL_BUTTON_PLANT);
+    ledEffectOff(HAL_BUTTON_DEFUSE);
+    break;
   }
 }
 
-void showDefusingLinesInDisplay()
+void setRunlevel(Runtime level)
 {
-  displayLinesInDisplay(F("Defusing"), 15, F("bomb."), 40, F("Please"), 30, F("wait"), 40);
+  runlevel = level;
+  updateButtonLeds();
+  if (menuLevel == SEARCH_DESTROY)
+  {
+    pulseOutputRunlevel(SEARCH_DESTROY_OUTPUTS, level);
+  }
+  else if (menuLevel == SABOTAGE)
+  {
+    pulseOutputRunlevel(SABOTAGE_OUTPUTS, level);
+  }
 }
 
-void showBombPlantedLinesInDisplay()
+void finishRound()
 {
-  displayLinesInDisplay(F("The Bomb "), 15, F("has been"), 15, F("planted"), 15, F(""), 0);
+  setRunlevel(END);
+  PulseOutputStats outputs = pulseOutputStats();
+  LOG_INFO(GAME, LOG_PULSE_OUTPUTS, outputs.pulses, outputs.maxLatencyMicros, outputs.safetyStops);
+#if INPUT_TRACE
+  inputTraceFlush();
+#endif
 }
 
-void showGameStartedLinesInDisplay()
+void startBombCountdown()
 {
-  displayLinesInDisplay(F("Game"), 40, F("running"), 20, F("Plant"), 30, F("the bomb"), 15);
+  countdownStart(explosionCountdown, halMillis(), explosionTimeLengthMinutes, 0);
+  schedulerStart(explodingTimer);
+  schedulerStart(beepBombTimer);
+  updateButtonLeds();
 }
 
-void cancelDefusingActionTrigger()
+// '#' starts a new round, '*' cuts the end of round fanfare short
+void applyRoundOverAction(char action)
 {
-  if (runlevel == DEFUSING)
+  if (action == '#')
   {
-    digitalWrite(DEFUSE_BUTTON_LED_PIN, LOW);
-    defuseButtonLedOn = false;
-#if DEBUG
-    Serial.println(F("Cancel defusing"));
-#endif
-
-    runlevel = PLANTED;
-    defusingTicker.stop();
-    showBombPlantedLinesInDisplay();
+    startNextRound();
+  }
+  else if (action == '*' && runlevel != END)
+  {
+    cueStop();
+    halAudioStop();
+    finishRound();
   }
 }
 
-void cancelPlantingBombActionTrigger()
+void startNextRound()
 {
-  if (runlevel == PLANTING)
-  {
-    digitalWrite(PLANT_BUTTON_LED_PIN, LOW);
-    plantButtonLedOn = false;
-#if DEBUG
-    Serial.println(F("Cancel planting"));
-#endif
+  cueStop();
+  halAudioStop();
+  stopTimers();
+  schedulerStop(plantingTimer);
 
-    runlevel = PLAYING;
-    plantingTicker.stop();
-    showGameStartedLinesInDisplay();
+  pulseOutputStopAll();
+  bombBeep = false;
+
+  setRunlevel(SETTINGS);
+  printMainMenu();
+}
+
+#if TELEMETRY
+// The countdown that matters in the current runlevel, as shown on the LEDs
+static long millisLeft()
+{
+  switch (runlevel)
+  {
+  case PLAYING:
+    return menuLevel == SABOTAGE ? deadlineMillisLeft(gameCountdown.end, halMillis()) : 0;
+  case PLANTING:
+    return deadlineMillisLeft(plantingCountdown.end, halMillis());
+  case PLANTED:
+    return deadlineMillisLeft(explosionCountdown.end, halMillis());
+  case DEFUSING:
+    return deadlineMillisLeft(defuseCountdown.end, halMillis());
+  default:
+    return 0;
   }
 }
 
+void sendTelemetry()
+{
+  long left = millisLeft();
+
+  TelemetryStatus status;
+  status.runlevel = runlevel;
+  status.menuLevel = menuLevel;
+  status.secondsLeft = left > 0 ? left / 1000L : 0;
+  status.buttons = (plantButtonPushed ? 1 : 0) | (defuseButtonPushed ? 2 : 0);
+  status.freeMemory = halFreeMemory();
+  telemetrySendStatus(status);
+}
+#endif
+
 void stopTimers()
 {
   clearLedDisplay();
-  updateGameTimeTicker.stop();
-  beepBombTicker.stop();
-  defusingTicker.stop();
-  explodingTicker.stop();
+  schedulerStop(updateGameTimeTimer);
+  schedulerStop(beepBombTimer);
+  schedulerStop(defusingTimer);
+  schedulerStop(explodingTimer);
 }
 
 void applySearchDestroyLevelAction(char action)
 {
   if (action == 'd')
   {
-    defusingActionTrigger();
+    defusingActionTrigger(halMillis());
   }
   else if (action == 'c')
   {
@@ -931,7 +961,7 @@ void applySabotageMenuLevelAction(char action)
 
   if (action == 'p')
   {
-    plantBombActionTrigger();
+    plantBombActionTrigger(halMillis());
   }
   else if (action == 'n')
   {
@@ -939,7 +969,7 @@ void applySabotageMenuLevelAction(char action)
   }
   else if (action == 'd')
   {
-    defusingActionTrigger();
+    defusingActionTrigger(halMillis());
   }
   else if (action == 'c')
   {
@@ -947,14 +977,14 @@ void applySabotageMenuLevelAction(char action)
   }
 }
 
-void playSound(char *sound)
+void playSound(uint8_t sound)
 {
 #if SD_CARD_CONNECTED
   if (!sdCardInitiated)
   {
     initSdCard();
   }
-  audio.play(sound);
+  halAudioPlay(sound);
 #endif
 }
 
@@ -962,9 +992,9 @@ void blink(int times, int delayTime)
 {
   for (int i = 0; i < times; i++)
   {
-    digitalWrite(LED_BUILTIN, HIGH);
-    delay(delayTime);
-    digitalWrite(LED_BUILTIN, LOW);
-    delay(delayTime);
+    halDigitalWrite(LED_BUILTIN, HIGH);
+    halDelay(delayTime);
+    halDigitalWrite(LED_BUILTIN, LOW);
+    halDelay(delayTime);
   }
 }
@@ -1,43 +1,78 @@
+#ifndef MAIN_H
+#define MAIN_H
+
 #include <Arduino.h>
 
+struct ScreenDescriptor;
+struct KeyEvent;
+struct ButtonEvent;
+struct GameSettings;
+
+enum MenuLevel
+{
+  MAIN,
+  SEARCH_DESTROY,
+  SABOTAGE,
+};
+
+enum Runtime
+{
+  SETTINGS,
+  PLAYING,
+  PLANTING,
+  PLANTED,
+  EXPLODED,
+  DEFUSING,
+  DEFUSED,
+  TIME_OVER,
+  END
+};
+
+
 void printMainMenu();
-void bigTextLine(String line, uint8_t x, uint8_t y);
-void smallTextLine(String line, uint8_t x, uint8_t y);
 void applyAction(char action);
 void applyMainMenuLevelAction(char action);
 void applySearchDestroyLevelAction(char action);
 void applySabotageMenuLevelAction(char action);
-void requestGameTime();
-void requestPlantingTime();
-void requestDefuseTime();
-void requestBombExplosionTime();
-void requestDefuseCode();
-void triggerGameStart();
-void countdown();
-String awaitForInput();
-void awaitOkCancel();
-char getInputIfAvailable();
+boolean nextKeyEvent(KeyEvent &event);
+boolean nextButtonEvent(ButtonEvent &event);
+void handleKeyEvent(const KeyEvent &event);
+GameSettings currentSettings();
+void quickStart(const GameSettings &settings, const char *name);
+void quickStartLastUsed();
+void quickStartPreset(uint8_t index);
+void saveLastUsedAsPreset(char key);
+void startGame();
+void startSearchDestroy();
+void startSabotage();
 void beepBomb();
 void updateGameTime();
 void defusingCallback();
 void plantingCallback();
 void explodingCallback();
-void bombLedCallback();
-void defuseLedCallback();
-void plantBombActionTrigger();
+void sendTelemetry();
+void plantBombActionTrigger(unsigned long pressedAtMillis);
 void cancelPlantingBombActionTrigger();
 void cancelDefusingActionTrigger();
-void defusingActionTrigger();
+void defusingActionTrigger(unsigned long pressedAtMillis);
 void stopTimers();
-void displayLinesInDisplay(String firstLine, uint8_t firstLineX, String secondLine, uint8_t secondLineX, String thirdLine, uint8_t thirdLineX, String forthLine, uint8_t forthLineX);
+void setRunlevel(Runtime level);
+void updateButtonLeds();
+void finishRound();
+void startBombCountdown();
+void startNextRound();
+void applyRoundOverAction(char action);
+void displayScreen(const ScreenDescriptor *screen);
 void showDefusingLinesInDisplay();
 void showBombPlantedLinesInDisplay();
 void showGameStartedLinesInDisplay();
-void displayLedCountdown(long totalSeconds);
+void displayLedCountdown(uint8_t minutes, uint8_t seconds);
 void displayLedNumber(long number);
 void clearLedDisplay();
 void updateButtonStatuses();
-void playSound(char* sound);
+void playSound(uint8_t sound);
 void blink(int times, int delay);
 void initSdCard();
-void (*resetFunc)(void) = 0; // Reset Arduino
\ No newline at end of file
+void idleUntilNextEvent();
+
+#endif
@@ -0,0 +1,61 @@
+#include "memoryStats.h"
+
+#ifdef ARDUINO
+
+#include <stdlib.h>
+
+extern char *__brkval;
+extern char *__malloc_heap_start;
+
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void *__real_realloc(void *pointer, size_t size);
+}
+
+static unsigned long allocations;
+static char *heapHighWater;
+
+static void *track(void *pointer)
+{
+  allocations++;
+  if (__brkval > heapHighWater)
+  {
+    heapHighWater = __brkval;
+  }
+  return pointer;
+}
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+  return track(__real_malloc(size));
+}
+
+extern "C" void *__wrap_realloc(void *pointer, size_t size)
+{
+  return track(__real_realloc(pointer, size));
+}
+
+unsigned long memoryAllocations()
+{
+  return allocations;
+}
+
+unsigned int memoryHeapHighWater()
+{
+  return heapHighWater ? heapHighWater - __malloc_heap_start : 0;
+}
+
+#else
+
+unsigned long memoryAllocations()
+{
+  return 0;
+}
+
+unsigned int memoryHeapHighWater()
+{
+  return 0;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <Arduino.h>
+
+// Heap accounting. On AVR malloc and realloc are wrapped at link time
+// (-Wl,--wrap, see platformio.ini) so every allocation, including the ones
+// String makes behind our back, is counted. The host build reports zeros.
+
+unsigned long memoryAllocations();
+// Highest address the heap has reached, as an offset from its start
+unsigned int memoryHeapHighWater();
+
+#endif
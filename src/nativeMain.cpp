@@ -0,0 +1,179 @@
+// Left out of `pio test`, where the test runner brings its own main()
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+
+// Host entry point. Runs the sketch on the virtual clock and feeds it a
+// timeline read from stdin, one event per line:
+//
+//   <millis> <key>       keypad tap, e.g. "1200 #", released after 80 ms
+//   <millis> <key>+      keypad key held down (<key>- released), e.g. "1200 #+"
+//   <millis> plant+      plant button pressed (plant- released)
+//   <millis> defuse+     defuse button pressed (defuse- released)
+//   <millis> end         stop the run
+//
+// Lines starting with ';' are comments.
+//
+// With --record <inputs.trc> the input trace (inputTrace.h) is saved when
+// the run stops. With --scenarios it plays random rounds instead, see
+// scenarioRunner.h. With --replay <inputs.trc> [boot] it replays an input trace copied from
+// the card (inputTrace.h), the last boot in it unless told otherwise, and
+// stops a few seconds after the round that was going on when the trace ran
+// out has ended.
+
+#include "halNative.h"
+#include "config.h"
+#include "scenarioRunner.h"
+#include "inputTrace.h"
+#include "main.h"
+
+#define KEY_TAP_MILLIS 80
+#define REPLAY_TAIL_MILLIS 5000UL
+
+extern Runtime runlevel;
+
+void setup();
+void loop();
+
+static unsigned long readTimeline(FILE *input)
+{
+  char line[64];
+  unsigned long lastMillis = 0;
+  unsigned long endMillis = 0;
+
+  while (fgets(line, sizeof(line), input))
+  {
+    unsigned long atMillis;
+    char token[16];
+    if (line[0] == ';' || sscanf(line, "%lu %15s", &atMillis, token) != 2)
+    {
+      continue;
+    }
+
+    HalNativeEvent event = {atMillis, HAL_NATIVE_KEY_DOWN, 0, token[0]};
+    if (strcmp(token, "end") == 0)
+    {
+      endMillis = atMillis;
+      continue;
+    }
+    else if (strcmp(token, "plant+") == 0 || strcmp(token, "plant-") == 0)
+    {
+      event.type = HAL_NATIVE_PIN;
+      event.pin = PLANT_BUTTON_PIN;
+      event.value = token[5] == '+' ? HIGH : LOW;
+    }
+    else if (strcmp(token, "defuse+") == 0 || strcmp(token, "defuse-") == 0)
+    {
+      event.type = HAL_NATIVE_PIN;
+      event.pin = DEFUSE_BUTTON_PIN;
+      event.value = token[6] == '+' ? HIGH : LOW;
+    }
+    else if (token[1] == '-')
+    {
+      event.type = HAL_NATIVE_KEY_UP;
+    }
+    else if (token[1] != '+')
+    {
+      HalNativeEvent release = {atMillis + KEY_TAP_MILLIS, HAL_NATIVE_KEY_UP, 0, token[0]};
+      halNativeSchedule(release);
+    }
+
+    halNativeSchedule(event);
+    if (atMillis > lastMillis)
+    {
+      lastMillis = atMillis;
+    }
+  }
+
+  // Without an explicit end, leave the sketch a few seconds after the last event
+  return endMillis ? endMillis : lastMillis + 5000UL;
+}
+
+static int runScenarios(unsigned long rounds, uint32_t seed)
+{
+  ScenarioResult result;
+  boolean passed = scenarioRun(rounds, seed, result);
+
+  printf("[scenario] %lu rounds, %lu time over, %lu exploded, %lu defused, %lu failed\n",
+         result.rounds, result.outcomes[0], result.outcomes[1], result.outcomes[2], result.failures);
+  printf("[scenario] %.1f virtual hours in %.2f s, %.0f rounds/s, %.0fx real time\n",
+         result.virtualMillis / 3600000.0, result.seconds, result.rounds / result.seconds,
+         result.virtualMillis / 1000.0 / result.seconds);
+  return passed ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc >= 3 && strcmp(argv[1], "--scenarios") == 0)
+  {
+    return runScenarios(strtoul(argv[2], NULL, 10), argc >= 4 ? strtoul(argv[3], NULL, 10) : 1);
+  }
+
+  halNativeInit();
+  const char *recordPath = argc >= 3 && strcmp(argv[1], "--record") == 0 ? argv[2] : NULL;
+  boolean replay = argc >= 3 && strcmp(argv[1], "--replay") == 0;
+  if (replay)
+  {
+    if (!halNativeLoadLog(HAL_LOG_INPUTS, argv[2]))
+    {
+      fprintf(stderr, "cannot read %s\n", argv[2]);
+      return 1;
+    }
+    inputTraceReplayBoot(argc >= 4 ? strtoul(argv[3], NULL, 10) : INPUT_TRACE_LAST_BOOT);
+  }
+  else
+  {
+    halNativeSetDeadline(readTimeline(stdin));
+  }
+
+  boolean booting = true;
+  while (true)
+  {
+    try
+    {
+      if (booting)
+      {
+        booting = false;
+        setup();
+        if (replay && !inputTraceReplaying())
+        {
+          fprintf(stderr, "no such boot in %s\n", argv[2]);
+          return 1;
+        }
+      }
+
+      while (true)
+      {
+        loop();
+        if (replay && !inputTraceReplaying() && (runlevel == SETTINGS || runlevel == END))
+        {
+          replay = false;
+          halNativeSetDeadline(halNativeNowMillis() + REPLAY_TAIL_MILLIS);
+        }
+      }
+    }
+    catch (const HalNativeReset &)
+    {
+      printf("\n[native] reset at %lu ms\n", halNativeNowMillis());
+      booting = true;
+    }
+    catch (const HalNativeStop &)
+    {
+      break;
+    }
+  }
+
+  printf("\n[native] stopped, relay fired %lu times, smoke %lu, strobe %lu, %lu sounds played\n",
+         halNativeOutputPulses(HAL_OUTPUT_RELAY), halNativeOutputPulses(HAL_OUTPUT_SMOKE),
+         halNativeOutputPulses(HAL_OUTPUT_STROBE), halNativeSoundsPlayed());
+  if (recordPath != NULL)
+  {
+    inputTraceFlush();
+    if (!halNativeSaveLog(HAL_LOG_INPUTS, recordPath))
+    {
+      fprintf(stderr, "cannot write %s\n", recordPath);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#endif
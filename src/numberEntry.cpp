@@ -0,0 +1,50 @@
+#include "numberEntry.h"
+
+void numberEntryBegin(NumberEntry &entry, uint16_t minimum, uint16_t maximum)
+{
+  entry.typed = 0;
+  entry.digits = 0;
+  entry.minimum = minimum;
+  entry.maximum = maximum;
+}
+
+boolean numberEntryKey(NumberEntry &entry, char key)
+{
+  if (key == NUMBER_ENTRY_BACKSPACE)
+  {
+    if (entry.digits == 0)
+    {
+      return false;
+    }
+    entry.digits--;
+    entry.typed /= 10;
+    return true;
+  }
+
+  if (key < '0' || key > '9' || entry.digits >= NUMBER_ENTRY_DIGITS)
+  {
+    return false;
+  }
+
+  entry.digits++;
+  entry.typed = entry.typed * 10 + (key - '0');
+  return true;
+}
+
+boolean numberEntryEmpty(const NumberEntry &entry)
+{
+  return entry.digits == 0;
+}
+
+uint16_t numberEntryValue(const NumberEntry &entry)
+{
+  if (entry.typed < entry.minimum)
+  {
+    return entry.minimum;
+  }
+  if (entry.typed > entry.maximum)
+  {
+    return entry.maximum;
+  }
+  return entry.typed;
+}
@@ -0,0 +1,30 @@
+#ifndef NUMBER_ENTRY_H
+#define NUMBER_ENTRY_H
+
+#include <Arduino.h>
+
+// A number typed on the keypad, one digit at a time. The digits are kept as
+// an integer, at most NUMBER_ENTRY_DIGITS of them, so a key costs a multiply
+// and an add; no String, no float. The value read back is clamped to the
+// field's range, which is also what the preview should show, so the referee
+// sees the number that will be used instead of one that wraps.
+
+#define NUMBER_ENTRY_DIGITS 4 // what the LED display can show
+#define NUMBER_ENTRY_BACKSPACE '\b'
+
+struct NumberEntry
+{
+  uint16_t typed; // the digits as typed, before clamping
+  uint8_t digits;
+  uint16_t minimum;
+  uint16_t maximum;
+};
+
+void numberEntryBegin(NumberEntry &entry, uint16_t minimum, uint16_t maximum);
+// Takes a digit, or NUMBER_ENTRY_BACKSPACE to drop the last one. Returns
+// false when the key changed nothing: not a digit, the entry full or empty.
+boolean numberEntryKey(NumberEntry &entry, char key);
+boolean numberEntryEmpty(const NumberEntry &entry);
+uint16_t numberEntryValue(const NumberEntry &entry);
+
+#endif
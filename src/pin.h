@@ -0,0 +1,133 @@
+#ifndef PIN_H
+#define PIN_H
+
+#include <Arduino.h>
+#include "hal.h"
+
+// Pin<N> resolves the port, bit and data direction register of Arduino pin
+// N at compile time. On AVR every call inlines to a single sbi, cbi or sbis
+// on a constant I/O address, where digitalWrite() looks the pin up in three
+// PROGMEM tables, checks for PWM and brackets the write with cli()/sei().
+// Only pins with a PIN_TRAITS entry below can be used; any other pin fails
+// to compile instead of silently falling back to the slow path. The host
+// build forwards to the HAL so the native pin model keeps working.
+
+#ifdef ARDUINO
+
+template <uint8_t N>
+struct PinTraits; // no definition: the pin has not been mapped yet
+
+// All of these ports sit in the low I/O space, so single bit set, clear and
+// test instructions reach them and are atomic without disabling interrupts.
+#define PIN_TRAITS(pin, port, bitIndex)        \
+  template <>                                  \
+  struct PinTraits<pin>                        \
+  {                                            \
+    static volatile uint8_t &out()             \
+    {                                          \
+      return PORT##port;                       \
+    }                                          \
+    static volatile uint8_t &in()              \
+    {                                          \
+      return PIN##port;                        \
+    }                                          \
+    static volatile uint8_t &direction()       \
+    {                                          \
+      return DDR##port;                        \
+    }                                          \
+    static const uint8_t mask = _BV(bitIndex); \
+  };
+
+// Arduino Mega 2560 pin mapping
+PIN_TRAITS(13, B, 7) // LED_BUILTIN
+PIN_TRAITS(34, C, 3)
+PIN_TRAITS(35, C, 2)
+PIN_TRAITS(36, C, 1)
+PIN_TRAITS(37, C, 0)
+PIN_TRAITS(39, G, 2)
+PIN_TRAITS(54, F, 0) // A0
+PIN_TRAITS(55, F, 1) // A1
+
+#undef PIN_TRAITS
+
+template <uint8_t N>
+struct Pin
+{
+  static void output()
+  {
+    PinTraits<N>::direction() |= PinTraits<N>::mask;
+  }
+
+  static void input()
+  {
+    PinTraits<N>::direction() &= ~PinTraits<N>::mask;
+    PinTraits<N>::out() &= ~PinTraits<N>::mask; // no pull-up
+  }
+
+  static void high()
+  {
+    PinTraits<N>::out() |= PinTraits<N>::mask;
+  }
+
+  static void low()
+  {
+    PinTraits<N>::out() &= ~PinTraits<N>::mask;
+  }
+
+  static void write(uint8_t value)
+  {
+    if (value)
+    {
+      high();
+    }
+    else
+    {
+      low();
+    }
+  }
+
+  static uint8_t read()
+  {
+    return (PinTraits<N>::in() & PinTraits<N>::mask) ? HIGH : LOW;
+  }
+};
+
+#else
+
+template <uint8_t N>
+struct Pin
+{
+  static void output()
+  {
+    halPinMode(N, OUTPUT);
+  }
+
+  static void input()
+  {
+    halPinMode(N, INPUT);
+  }
+
+  static void high()
+  {
+    halDigitalWrite(N, HIGH);
+  }
+
+  static void low()
+  {
+    halDigitalWrite(N, LOW);
+  }
+
+  static void write(uint8_t value)
+  {
+    halDigitalWrite(N, value ? HIGH : LOW);
+  }
+
+  static uint8_t read()
+  {
+    return halDigitalRead(N);
+  }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#include "presets.h"
+#include "main.h"
+#include "hal.h"
+
+struct PresetRecord
+{
+  char name[PRESET_NAME_CHARS + 1];
+  GameSettings settings;
+  uint8_t crc;
+};
+
+struct LastUsedRecord
+{
+  uint16_t sequence;
+  GameSettings settings;
+  uint8_t crc;
+};
+
+#define PRESETS_ADDRESS PRESET_EEPROM_ADDRESS
+#define LAST_USED_ADDRESS (PRESETS_ADDRESS + PRESET_COUNT * sizeof(PresetRecord))
+
+// Keys 4 to 9 of the main menu, until a preset is saved over them
+const PresetRecord DEFAULT_PRESETS[PRESET_COUNT] PROGMEM = {
+    {"Sabotage10", {SABOTAGE, 10, 5, 2, 10}, 0},
+    {"Sabotage20", {SABOTAGE, 20, 5, 3, 10}, 0},
+    {"Sabotage30", {SABOTAGE, 30, 10, 5, 15}, 0},
+    {"S&D 2 min", {SEARCH_DESTROY, 0, 0, 2, 10}, 0},
+    {"S&D 5 min", {SEARCH_DESTROY, 0, 0, 5, 10}, 0},
+    {"S&D 10 min", {SEARCH_DESTROY, 0, 0, 10, 15}, 0},
+};
+
+static int8_t lastUsedSlot = -1; // newest valid record, -1 when none
+static LastUsedRecord lastUsed;
+
+// CRC-8, polynomial 0x07, over everything but the trailing crc byte
+static uint8_t crc8(const void *data, uint8_t length)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    crc ^= bytes[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Guards against records from an older layout that happen to pass the CRC
+static boolean settingsValid(const GameSettings &settings)
+{
+  return settings.mode == SEARCH_DESTROY || settings.mode == SABOTAGE;
+}
+
+static uint16_t lastUsedAddress(uint8_t slot)
+{
+  return LAST_USED_ADDRESS + slot * sizeof(LastUsedRecord);
+}
+
+void presetsBegin()
+{
+  lastUsedSlot = -1;
+  for (uint8_t slot = 0; slot < PRESET_LAST_USED_SLOTS; slot++)
+  {
+    LastUsedRecord record;
+    halEepromRead(lastUsedAddress(slot), &record, sizeof(record));
+    if (record.crc != crc8(&record, sizeof(record) - 1) || !settingsValid(record.settings))
+    {
+      continue;
+    }
+
+    // Sequence numbers wrap; the records alive at any time are close together
+    if (lastUsedSlot < 0 || (int16_t)(record.sequence - lastUsed.sequence) > 0)
+    {
+      lastUsedSlot = slot;
+      lastUsed = record;
+    }
+  }
+}
+
+void presetLoad(uint8_t index, GameSettings &settings, char *name)
+{
+  PresetRecord record;
+  halEepromRead(PRESETS_ADDRESS + index * sizeof(PresetRecord), &record, sizeof(record));
+  if (record.crc != crc8(&record, sizeof(record) - 1) || !settingsValid(record.settings))
+  {
+    memcpy_P(&record, &DEFAULT_PRESETS[index], sizeof(record));
+  }
+
+  settings = record.settings;
+  memcpy(name, record.name, PRESET_NAME_CHARS);
+  name[PRESET_NAME_CHARS] = '\0';
+}
+
+void presetSave(uint8_t index, const GameSettings &settings, const char *name)
+{
+  PresetRecord record;
+  memset(&record, 0, sizeof(record));
+  strncpy(record.name, name, PRESET_NAME_CHARS);
+  record.settings = settings;
+  record.crc = crc8(&record, sizeof(record) - 1);
+  halEepromUpdate(PRESETS_ADDRESS + index * sizeof(PresetRecord), &record, sizeof(record));
+}
+
+boolean presetLoadLastUsed(GameSettings &settings)
+{
+  if (lastUsedSlot < 0)
+  {
+    return false;
+  }
+  settings = lastUsed.settings;
+  return true;
+}
+
+void presetSaveLastUsed(const GameSettings &settings)
+{
+  if (lastUsedSlot >= 0 && memcmp(&lastUsed.settings, &settings, sizeof(settings)) == 0)
+  {
+    return;
+  }
+
+  lastUsed.sequence = lastUsedSlot < 0 ? 0 : lastUsed.sequence + 1;
+  lastUsed.settings = settings;
+  lastUsed.crc = crc8(&lastUsed, sizeof(lastUsed) - 1);
+  lastUsedSlot = (lastUsedSlot + 1) % PRESET_LAST_USED_SLOTS;
+  halEepromUpdate(lastUsedAddress(lastUsedSlot), &lastUsed, sizeof(lastUsed));
+}
@@ -0,0 +1,39 @@
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include <Arduino.h>
+
+// Game settings kept in EEPROM so a round can start without the setup
+// prompts: PRESET_COUNT named presets, plus the settings of the last round
+// started, saved automatically. Every record carries a CRC-8; a preset
+// that fails it reads back as its built-in default, a last used record
+// that fails it is ignored.
+//
+// The last used settings are saved at every round start, so they rotate
+// through PRESET_LAST_USED_SLOTS records tagged with a sequence number to
+// spread the wear; the valid record with the newest sequence wins.
+
+#define PRESET_COUNT 6
+#define PRESET_NAME_CHARS 10 // what fits a 2X line of the OLED
+#define PRESET_LAST_USED_SLOTS 16
+#define PRESET_EEPROM_ADDRESS 0
+
+struct GameSettings
+{
+  uint8_t mode; // MenuLevel, SEARCH_DESTROY or SABOTAGE
+  uint8_t gameLengthMinutes;
+  uint8_t plantingTimeLengthSeconds;
+  uint8_t explosionTimeLengthMinutes;
+  uint8_t defusingTimeLengthSeconds;
+};
+
+void presetsBegin();
+// name gets PRESET_NAME_CHARS + 1 bytes
+void presetLoad(uint8_t index, GameSettings &settings, char *name);
+void presetSave(uint8_t index, const GameSettings &settings, const char *name);
+// False until a round has been started with this EEPROM
+boolean presetLoadLastUsed(GameSettings &settings);
+// Writes nothing when the settings did not change
+void presetSaveLastUsed(const GameSettings &settings);
+
+#endif
@@ -0,0 +1,220 @@
+#include "pulseOutput.h"
+#include "config.h"
+#include "hal.h"
+
+enum PulsePhase
+{
+  PHASE_IDLE,
+  PHASE_DELAY,
+  PHASE_ON,
+  PHASE_OFF,
+};
+
+// Owned by the interrupt once the timer runs; the loop() side only touches
+// it with interrupts off
+struct Channel
+{
+  uint8_t phase;
+  uint8_t count;      // pulses left, 0 for no end
+  uint16_t remaining; // ticks until the next phase, counting this one
+  uint16_t onMillis;
+  uint16_t offMillis;
+  uint16_t onFor; // ticks the output has been on in one go
+};
+
+static const uint16_t maxOnMillis[HAL_OUTPUT_COUNT] = {RELAY_MAX_ON_MILLIS, SMOKE_MAX_ON_MILLIS, STROBE_MAX_ON_MILLIS};
+
+static Channel channels[HAL_OUTPUT_COUNT];
+static volatile boolean timerRunning;
+static volatile boolean fed;
+static uint16_t unfedMillis;
+static PulseOutputStats stats;
+
+static void stop(uint8_t output)
+{
+  channels[output].phase = PHASE_IDLE;
+  halOutputWrite(output, false);
+}
+
+static void switchOn(uint8_t output, Channel &channel)
+{
+  halOutputWrite(output, true);
+  channel.phase = PHASE_ON;
+  channel.remaining = channel.onMillis;
+  stats.pulses++;
+}
+
+static void advance(uint8_t output, Channel &channel)
+{
+  switch (channel.phase)
+  {
+  case PHASE_DELAY:
+  case PHASE_OFF:
+    channel.onFor = 0;
+    switchOn(output, channel);
+    break;
+
+  case PHASE_ON:
+    if (channel.count == 1)
+    {
+      stop(output);
+      break;
+    }
+    if (channel.count > 1)
+    {
+      channel.count--;
+    }
+
+    if (channel.offMillis == 0)
+    {
+      channel.remaining = channel.onMillis; // stays on, onFor keeps counting
+    }
+    else
+    {
+      halOutputWrite(output, false);
+      channel.phase = PHASE_OFF;
+      channel.remaining = channel.offMillis;
+    }
+    break;
+  }
+}
+
+// Runs every millisecond in interrupt context while an output is busy
+static boolean tick()
+{
+  if (fed)
+  {
+    fed = false;
+    unfedMillis = 0;
+  }
+  else if (++unfedMillis >= PULSE_OUTPUT_WATCHDOG_MILLIS)
+  {
+    for (uint8_t output = 0; output < HAL_OUTPUT_COUNT; output++)
+    {
+      if (channels[output].phase != PHASE_IDLE)
+      {
+        stats.safetyStops++;
+        stop(output);
+      }
+    }
+  }
+
+  boolean active = false;
+  for (uint8_t output = 0; output < HAL_OUTPUT_COUNT; output++)
+  {
+    Channel &channel = channels[output];
+    if (channel.phase == PHASE_IDLE)
+    {
+      continue;
+    }
+
+    if (channel.phase == PHASE_ON && ++channel.onFor > maxOnMillis[output])
+    {
+      stats.safetyStops++;
+      stop(output);
+      continue;
+    }
+
+    if (--channel.remaining == 0)
+    {
+      advance(output, channel);
+    }
+    active = active || channel.phase != PHASE_IDLE;
+  }
+
+  timerRunning = active;
+  return active;
+}
+
+void pulseOutputBegin()
+{
+  halOutputsBegin();
+  // After a reset the timer may still be ticking, starting it again is harmless
+  timerRunning = false;
+  for (uint8_t output = 0; output < HAL_OUTPUT_COUNT; output++)
+  {
+    stop(output);
+  }
+}
+
+void pulseOutputStart(uint8_t output, const PulseTrain &train)
+{
+  uint16_t onMillis = train.onMillis;
+  noInterrupts();
+  if (onMillis > maxOnMillis[output])
+  {
+    onMillis = maxOnMillis[output];
+    stats.safetyStops++;
+  }
+
+  Channel &channel = channels[output];
+  if (onMillis == 0)
+  {
+    stop(output);
+    interrupts();
+    return;
+  }
+
+  halOutputWrite(output, false);
+  channel.phase = PHASE_DELAY;
+  channel.count = train.count;
+  // The first tick comes within a millisecond and counts as the first one
+  channel.remaining = train.delayMillis < 0xFFFF ? train.delayMillis + 1 : 0xFFFF;
+  channel.onMillis = onMillis;
+  channel.offMillis = train.offMillis;
+  channel.onFor = 0;
+
+  fed = true;
+  if (!timerRunning)
+  {
+    timerRunning = true;
+    halTimerStart(HAL_TIMER_OUTPUTS, tick);
+  }
+  interrupts();
+}
+
+void pulseOutputRunlevel(const PulseTrigger *triggers, uint8_t runlevel)
+{
+  for (uint8_t index = 0;; index++)
+  {
+    PulseTrigger trigger;
+    memcpy_P(&trigger, &triggers[index], sizeof(PulseTrigger));
+    if (trigger.runlevel == PULSE_NO_RUNLEVEL)
+    {
+      break;
+    }
+    if (trigger.runlevel == runlevel)
+    {
+      pulseOutputStart(trigger.output, trigger.train);
+    }
+  }
+}
+
+void pulseOutputStopAll()
+{
+  noInterrupts();
+  for (uint8_t output = 0; output < HAL_OUTPUT_COUNT; output++)
+  {
+    stop(output);
+  }
+  interrupts();
+}
+
+void pulseOutputFeed()
+{
+  fed = true;
+}
+
+boolean pulseOutputActive()
+{
+  return timerRunning;
+}
+
+PulseOutputStats pulseOutputStats()
+{
+  noInterrupts();
+  PulseOutputStats copy = stats;
+  interrupts();
+  copy.maxLatencyMicros = halTimerMaxLatencyMicros();
+  return copy;
+}
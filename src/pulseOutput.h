@@ -0,0 +1,53 @@
+#ifndef PULSE_OUTPUT_H
+#define PULSE_OUTPUT_H
+
+#include <Arduino.h>
+
+// The effect outputs (relay, smoke machine, strobe, see HalOutput in hal.h)
+// play pulse trains from a 1 ms timer interrupt, so the edges land on the
+// millisecond whatever loop() is busy with; the HAL reports the worst
+// interrupt latency. Safety: a pulse is never longer than its output's
+// *_MAX_ON_MILLIS, and when loop() stops calling pulseOutputFeed() for
+// PULSE_OUTPUT_WATCHDOG_MILLIS every output is switched off.
+
+// Waits delayMillis, then switches on for onMillis and off for offMillis,
+// count times. A count of 0 repeats until stopped.
+struct PulseTrain
+{
+  uint16_t delayMillis;
+  uint16_t onMillis;
+  uint16_t offMillis;
+  uint8_t count;
+};
+
+// What each output plays when the game enters a runlevel. Tables are
+// PROGMEM arrays, one per game mode, ending with PULSE_TRIGGERS_END().
+struct PulseTrigger
+{
+  uint8_t runlevel; // Runtime
+  uint8_t output;   // HalOutput
+  PulseTrain train;
+};
+
+#define PULSE_NO_RUNLEVEL 0xFF
+#define PULSE_TRIGGERS_END() {PULSE_NO_RUNLEVEL, 0, {0, 0, 0, 0}}
+
+struct PulseOutputStats
+{
+  unsigned long pulses;      // on edges, all outputs
+  unsigned long safetyStops; // pulses cut short or trains dropped for safety
+  uint16_t maxLatencyMicros; // timer compare to interrupt, worst case
+};
+
+void pulseOutputBegin();
+// Replaces whatever the output was playing
+void pulseOutputStart(uint8_t output, const PulseTrain &train);
+// Starts the trains of triggers listed for runlevel
+void pulseOutputRunlevel(const PulseTrigger *triggers, uint8_t runlevel);
+void pulseOutputStopAll();
+// Call from every loop() iteration
+void pulseOutputFeed();
+boolean pulseOutputActive();
+PulseOutputStats pulseOutputStats();
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <Arduino.h>
+
+#define RING_BUFFER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// Lock free single producer / single consumer queue. One side may run in an
+// interrupt: the producer only writes head, the consumer only writes tail,
+// and both indexes are single bytes so every access is atomic on AVR.
+// Size must be a power of two; one slot is kept free to tell full from empty.
+template <typename T, uint8_t Size>
+class RingBuffer
+{
+public:
+  RingBuffer() : head(0), tail(0), dropped(0) {}
+
+  // Producer side. Returns false and counts the item when the queue is full
+  boolean push(const T &item)
+  {
+    uint8_t next = (head + 1) & (Size - 1);
+    if (next == tail)
+    {
+      dropped++;
+      return false;
+    }
+
+    items[head] = item;
+    RING_BUFFER_BARRIER(); // the item must be stored before it is published
+    head = next;
+    return true;
+  }
+
+  // Consumer side
+  boolean pop(T &item)
+  {
+    if (tail == head)
+    {
+      return false;
+    }
+
+    RING_BUFFER_BARRIER();
+    item = items[tail];
+    RING_BUFFER_BARRIER(); // the item must be read before the slot is released
+    tail = (tail + 1) & (Size - 1);
+    return true;
+  }
+
+  // Only safe while the producer is quiet
+  void clear()
+  {
+    tail = head;
+  }
+
+  boolean empty() const
+  {
+    return tail == head;
+  }
+
+  uint8_t droppedCount() const
+  {
+    return dropped;
+  }
+
+private:
+  T items[Size];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  volatile uint8_t dropped;
+};
+
+#endif
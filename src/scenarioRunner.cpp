@@ -0,0 +1,559 @@
+#ifndef ARDUINO
+
+#include "scenarioRunner.h"
+#include "halNative.h"
+#include "main.h"
+#include "config.h"
+#include "setupWizard.h"
+#include <chrono>
+#include <vector>
+
+#define KEY_TAP_MILLIS 80
+#define KEY_GAP_MILLIS 250
+#define MIN_HOLD_MILLIS 50
+// Timers fire one interval after their callback last ran, plus loop() latency
+#define TICK_SLACK_MILLIS 1500
+// Tolerated lag between an edge on the wire and the runlevel it causes
+#define EDGE_SLACK_MILLIS 50
+// Longest end of round sequence, see the *_CUES tables in main.cpp
+#define CUES_MILLIS 8000
+#define SEARCH_DESTROY_ARMING_MILLIS 1500
+// Reboot the virtual board well before millis() wraps, halNative.cpp
+// schedules inputs on a 32 bit millisecond timeline
+#define REBOOT_AFTER_MILLIS 0x80000000UL
+
+extern Runtime runlevel;
+
+void setup();
+void loop();
+
+struct Press
+{
+  uint8_t pin;
+  unsigned long atMillis;
+  unsigned long releaseMillis;
+};
+
+struct Round
+{
+  unsigned long number;
+  uint32_t seed;
+  uint32_t random;
+  uint8_t mode; // MenuLevel
+  uint8_t gameMinutes;
+  uint8_t plantSeconds;
+  uint8_t bombMinutes;
+  uint8_t defuseSeconds;
+  std::vector<Press> presses;
+
+  unsigned long startMillis;
+  unsigned long plantedMillis;
+  unsigned long actionMillis;    // entered PLANTING or DEFUSING
+  unsigned long actionEndMillis; // left it without completing
+  boolean planted;
+  Runtime terminal;
+  Runtime previous;
+  boolean failed;
+};
+
+static uint32_t nextRandom(uint32_t &state)
+{
+  // xorshift32, the same sequence on every host
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static uint32_t randomBetween(Round &round, uint32_t low, uint32_t high)
+{
+  return low + nextRandom(round.random) % (high - low + 1);
+}
+
+static void fail(Round &round, const char *rule)
+{
+  if (!round.failed)
+  {
+    round.failed = true;
+    printf("[scenario] round %lu seed %lu: %s at %lu ms (runlevel %d, previous %d)\n",
+           round.number, (unsigned long)round.seed, rule, halNativeNowMillis(), runlevel, round.previous);
+    printf("[scenario] %s, game %u min, plant %u s, bomb %u min, defuse %u s, started at %lu ms\n",
+           round.mode == SABOTAGE ? "sabotage" : "search and destroy", round.gameMinutes, round.plantSeconds,
+           round.bombMinutes, round.defuseSeconds, round.startMillis);
+    for (size_t index = 0; index < round.presses.size(); index++)
+    {
+      const Press &press = round.presses[index];
+      printf("[scenario] %s %lu-%lu ms\n", press.pin == PLANT_BUTTON_PIN ? "plant" : "defuse", press.atMillis, press.releaseMillis);
+    }
+  }
+}
+
+static boolean isTerminal(Runtime level)
+{
+  return level == TIME_OVER || level == EXPLODED || level == DEFUSED;
+}
+
+// Negative while fromMillis is still ahead
+static long since(unsigned long fromMillis)
+{
+  return (long)(halNativeNowMillis() - fromMillis);
+}
+
+// The scheduled press of pin that covers the current time, if any
+static const Press *heldPress(const Round &round, uint8_t pin)
+{
+  unsigned long now = halNativeNowMillis();
+  for (size_t index = 0; index < round.presses.size(); index++)
+  {
+    const Press &press = round.presses[index];
+    if (press.pin == pin && (long)(now - press.atMillis) >= 0 && (long)(press.releaseMillis + EDGE_SLACK_MILLIS - now) >= 0)
+    {
+      return &press;
+    }
+  }
+  return NULL;
+}
+
+static boolean allowedTransition(Runtime from, Runtime to)
+{
+  switch (from)
+  {
+  case SETTINGS:
+    return to == PLAYING || to == PLANTED;
+  case PLAYING:
+    return to == PLANTING || to == TIME_OVER;
+  case PLANTING:
+    // A cancel and the game clock can land in the same iteration
+    return to == PLAYING || to == PLANTED || to == TIME_OVER;
+  case PLANTED:
+    return to == DEFUSING || to == EXPLODED;
+  case DEFUSING:
+    return to == PLANTED || to == DEFUSED || to == EXPLODED;
+  default:
+    return to == END || to == SETTINGS;
+  }
+}
+
+static void checkTransition(Round &round, Runtime to)
+{
+  Runtime from = round.previous;
+  if (!allowedTransition(from, to))
+  {
+    fail(round, "runlevel change not allowed");
+    return;
+  }
+
+  if (from == SETTINGS)
+  {
+    round.startMillis = halNativeNowMillis();
+    if (to != (round.mode == SABOTAGE ? PLAYING : PLANTED))
+    {
+      fail(round, "round started in the wrong mode");
+    }
+    if (to == PLANTED)
+    {
+      round.planted = true;
+      round.plantedMillis = round.startMillis + SEARCH_DESTROY_ARMING_MILLIS;
+    }
+  }
+
+  if (isTerminal(to))
+  {
+    if (isTerminal(round.terminal))
+    {
+      fail(round, "second end of round");
+    }
+    round.terminal = to;
+  }
+
+  const Press *press;
+  switch (to)
+  {
+  case PLANTING:
+  case DEFUSING:
+    round.actionMillis = halNativeNowMillis();
+    if (heldPress(round, to == PLANTING ? PLANT_BUTTON_PIN : DEFUSE_BUTTON_PIN) == NULL)
+    {
+      fail(round, "action started without its button held");
+    }
+    // Defusing while Search & Destroy arms starts the bomb countdown early
+    if (to == DEFUSING && since(round.plantedMillis) < 0)
+    {
+      round.plantedMillis = halNativeNowMillis();
+    }
+    break;
+
+  case PLAYING:
+    round.actionEndMillis = halNativeNowMillis();
+    break;
+
+  case PLANTED:
+    round.actionEndMillis = halNativeNowMillis();
+    if (from == PLANTING)
+    {
+      press = heldPress(round, PLANT_BUTTON_PIN);
+      if (press == NULL || since(press->atMillis) + 1000L < round.plantSeconds * 1000L)
+      {
+        fail(round, "planted without holding the button long enough");
+      }
+      round.planted = true;
+      round.plantedMillis = halNativeNowMillis();
+    }
+    break;
+
+  case DEFUSED:
+    press = heldPress(round, DEFUSE_BUTTON_PIN);
+    if (press == NULL || since(press->atMillis) + 1000L < round.defuseSeconds * 1000L)
+    {
+      fail(round, "defused without holding the button long enough");
+    }
+    break;
+
+  case TIME_OVER:
+    if (round.mode != SABOTAGE || since(round.startMillis) + 1000L < round.gameMinutes * 60000L)
+    {
+      fail(round, "time over before the game length");
+    }
+    break;
+
+  case EXPLODED:
+    if (!round.planted || since(round.plantedMillis) + 1000L < round.bombMinutes * 60000L)
+    {
+      fail(round, "exploded before the bomb time");
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+// Time since the deadline, counted from the end of the last planting or
+// defusing when that came later: the clocks are only checked in between
+static long overdue(Round &round, unsigned long deadlineMillis)
+{
+  long sinceDeadline = since(deadlineMillis);
+  long sinceAction = since(round.actionEndMillis);
+  return sinceAction < sinceDeadline ? sinceAction : sinceDeadline;
+}
+
+// Rules that hold at any time, not only on a runlevel change
+static void checkState(Round &round)
+{
+  if (halNativeRelayOn() && round.terminal != EXPLODED)
+  {
+    fail(round, "relay on without an explosion");
+  }
+
+  switch (runlevel)
+  {
+  case PLAYING:
+    if (overdue(round, round.startMillis + round.gameMinutes * 60000UL) > TICK_SLACK_MILLIS)
+    {
+      fail(round, "game time overran");
+    }
+    break;
+  case PLANTING:
+    if (since(round.actionMillis) > round.plantSeconds * 1000L + TICK_SLACK_MILLIS)
+    {
+      fail(round, "planting overran");
+    }
+    break;
+  case DEFUSING:
+    if (since(round.actionMillis) > round.defuseSeconds * 1000L + TICK_SLACK_MILLIS)
+    {
+      fail(round, "defusing overran");
+    }
+    break;
+  case PLANTED:
+    if (round.planted && overdue(round, round.plantedMillis + round.bombMinutes * 60000UL) > TICK_SLACK_MILLIS)
+    {
+      fail(round, "bomb time overran");
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static Round *checkedRound;
+
+static void check()
+{
+  Round &round = *checkedRound;
+  if (runlevel != round.previous)
+  {
+    checkTransition(round, runlevel);
+    round.previous = runlevel;
+  }
+  checkState(round);
+}
+
+// Runs loop() until done() or until the virtual clock reaches limitMillis.
+// The rules are checked when loop() goes idle, before the clock jumps to
+// the next event, and again after it returns.
+static boolean runUntil(Round &round, boolean (*done)(), unsigned long limitMillis)
+{
+  checkedRound = &round;
+  halNativeOnIdle(check);
+  while (!done() && !round.failed)
+  {
+    if ((long)(halNativeNowMillis() - limitMillis) >= 0)
+    {
+      break;
+    }
+
+    loop();
+    check();
+  }
+  halNativeOnIdle(NULL);
+  return done() && !round.failed;
+}
+
+static boolean started()
+{
+  return runlevel != SETTINGS;
+}
+
+static boolean ended()
+{
+  return isTerminal(runlevel) || runlevel == END;
+}
+
+static boolean finished()
+{
+  return runlevel == END;
+}
+
+static boolean inMenu()
+{
+  return runlevel == SETTINGS;
+}
+
+static boolean inputsDone()
+{
+  return !halNativePendingEvents();
+}
+
+static unsigned long tap(char key, unsigned long atMillis)
+{
+  HalNativeEvent down = {atMillis, HAL_NATIVE_KEY_DOWN, 0, key};
+  HalNativeEvent up = {atMillis + KEY_TAP_MILLIS, HAL_NATIVE_KEY_UP, 0, key};
+  halNativeSchedule(down);
+  halNativeSchedule(up);
+  return atMillis + KEY_GAP_MILLIS;
+}
+
+static unsigned long typeNumber(uint8_t value, unsigned long atMillis)
+{
+  if (value >= 10)
+  {
+    atMillis = tap('0' + value / 10, atMillis);
+  }
+  atMillis = tap('0' + value % 10, atMillis);
+  return tap('#', atMillis);
+}
+
+static void chooseSettings(Round &round, Round &last)
+{
+  // Drawn first and always, so a round replays with the same draws
+  boolean quickStart = randomBetween(round, 0, 7) == 0;
+  if (quickStart && last.number > 0)
+  {
+    // Quick start with the settings of the last round
+    round.mode = last.mode;
+    round.gameMinutes = last.gameMinutes;
+    round.plantSeconds = last.plantSeconds;
+    round.bombMinutes = last.bombMinutes;
+    round.defuseSeconds = last.defuseSeconds;
+    tap('3', halNativeNowMillis() + KEY_GAP_MILLIS);
+    return;
+  }
+
+  round.mode = randomBetween(round, 0, 1) ? SABOTAGE : SEARCH_DESTROY;
+  round.gameMinutes = randomBetween(round, 1, 3);
+  round.plantSeconds = randomBetween(round, 1, 15);
+  round.bombMinutes = randomBetween(round, 1, 3);
+  round.defuseSeconds = randomBetween(round, 1, 15);
+
+  unsigned long at = halNativeNowMillis() + KEY_GAP_MILLIS;
+  if (round.mode == SABOTAGE)
+  {
+    at = tap('2', at);
+    at = typeNumber(round.gameMinutes, at);
+    at = typeNumber(round.plantSeconds, at);
+  }
+  else
+  {
+    at = tap('1', at);
+  }
+  at = typeNumber(round.bombMinutes, at);
+  at = typeNumber(round.defuseSeconds, at);
+  tap('#', at);
+}
+
+// Holds that fall short of, straddle and exceed what the action needs
+static unsigned long chooseHold(Round &round, uint8_t neededSeconds)
+{
+  unsigned long needed = neededSeconds * 1000UL;
+  switch (randomBetween(round, 0, 2))
+  {
+  case 0:
+    return randomBetween(round, MIN_HOLD_MILLIS, 999);
+  case 1:
+    return max((unsigned long)MIN_HOLD_MILLIS, needed - 1000UL + randomBetween(round, 0, 2000));
+  default:
+    return needed + randomBetween(round, 0, 3000);
+  }
+}
+
+// Returns when the last button is released
+static unsigned long schedulePresses(Round &round)
+{
+  // loop() may have slept past the start before the runner got back control,
+  // inputs in the past would land late
+  unsigned long at = halNativeNowMillis() + 1;
+  uint8_t count = randomBetween(round, 0, 6);
+  for (uint8_t index = 0; index < count; index++)
+  {
+    boolean defuse = round.mode == SEARCH_DESTROY ? randomBetween(round, 0, 4) > 0 : randomBetween(round, 0, 1) == 0;
+
+    Press press;
+    press.pin = defuse ? DEFUSE_BUTTON_PIN : PLANT_BUTTON_PIN;
+    press.atMillis = at + randomBetween(round, 0, 15000);
+    press.releaseMillis = press.atMillis + chooseHold(round, defuse ? round.defuseSeconds : round.plantSeconds);
+    round.presses.push_back(press);
+
+    HalNativeEvent down = {press.atMillis, HAL_NATIVE_PIN, press.pin, HIGH};
+    HalNativeEvent up = {press.releaseMillis, HAL_NATIVE_PIN, press.pin, LOW};
+    halNativeSchedule(down);
+    halNativeSchedule(up);
+    at = press.releaseMillis + MIN_HOLD_MILLIS;
+  }
+  return at;
+}
+
+static boolean playRound(Round &round, Round &last)
+{
+  round.random = round.seed ? round.seed : 1;
+  round.terminal = SETTINGS;
+  round.previous = runlevel;
+  round.planted = false;
+  round.failed = false;
+  round.startMillis = halNativeNowMillis();
+  round.actionEndMillis = round.startMillis;
+  unsigned long relayPulses = halNativeOutputPulses(HAL_OUTPUT_RELAY);
+
+  chooseSettings(round, last);
+  if (!runUntil(round, started, halNativeNowMillis() + WIZARD_COUNTDOWN_MILLIS + 20000UL))
+  {
+    fail(round, "round did not start");
+    return false;
+  }
+
+  unsigned long lastRelease = schedulePresses(round);
+  unsigned long limit = lastRelease + (round.gameMinutes + round.bombMinutes) * 60000UL + 30000UL;
+  if (!runUntil(round, ended, limit))
+  {
+    fail(round, "round did not end");
+    return false;
+  }
+
+  // '#' may cut the end of round sequence short
+  if (randomBetween(round, 0, 3) == 0)
+  {
+    tap('#', halNativeNowMillis() + randomBetween(round, 0, 3000));
+  }
+  else if (!runUntil(round, finished, halNativeNowMillis() + CUES_MILLIS))
+  {
+    fail(round, "end of round sequence did not finish");
+    return false;
+  }
+  else
+  {
+    tap('#', halNativeNowMillis() + KEY_GAP_MILLIS);
+  }
+
+  if (!runUntil(round, inMenu, halNativeNowMillis() + CUES_MILLIS + 5000UL))
+  {
+    fail(round, "no way back to the menu");
+    return false;
+  }
+
+  if (halNativeRelayOn())
+  {
+    fail(round, "relay left on in the menu");
+  }
+  if ((round.terminal == EXPLODED) != (halNativeOutputPulses(HAL_OUTPUT_RELAY) != relayPulses))
+  {
+    fail(round, round.terminal == EXPLODED ? "explosion without firing the relay" : "relay fired without an explosion");
+  }
+
+  // Presses scheduled past the end of the round land in the menu, where
+  // they must not start anything
+  if ((long)(lastRelease - halNativeNowMillis()) < 0)
+  {
+    lastRelease = halNativeNowMillis();
+  }
+  if (!runUntil(round, inputsDone, lastRelease + 1000UL) && !round.failed)
+  {
+    fail(round, "inputs still pending");
+  }
+  return !round.failed;
+}
+
+static void boot()
+{
+  halNativeInit();
+  setup();
+  // Let the boot sequence settle in the main menu
+  unsigned long settle = halNativeNowMillis() + 2000UL;
+  while ((long)(halNativeNowMillis() - settle) < 0)
+  {
+    loop();
+  }
+}
+
+boolean scenarioRun(unsigned long rounds, uint32_t seed, ScenarioResult &result)
+{
+  memset(&result, 0, sizeof(result));
+  Serial.muted = true;
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+  uint32_t seeds = seed ? seed : 1;
+  Round last;
+  last.number = 0;
+
+  boot();
+  for (unsigned long number = 1; number <= rounds; number++)
+  {
+    if (halNativeNowMillis() >= REBOOT_AFTER_MILLIS)
+    {
+      result.virtualMillis += halNativeNowMillis();
+      boot();
+    }
+
+    Round round;
+    round.number = number;
+    // A single round replays with --scenarios 1 <its seed>
+    round.seed = number == 1 ? seeds : nextRandom(seeds);
+
+    boolean passed = playRound(round, last);
+    result.rounds++;
+    if (!passed)
+    {
+      result.failures++;
+      break;
+    }
+
+    result.outcomes[round.terminal == TIME_OVER ? 0 : round.terminal == EXPLODED ? 1 : 2]++;
+    last = round;
+  }
+
+  result.virtualMillis += halNativeNowMillis();
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  Serial.muted = false;
+  return result.failures == 0;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SCENARIO_RUNNER_H
+#define SCENARIO_RUNNER_H
+
+#ifndef ARDUINO
+
+#include <Arduino.h>
+
+// Plays randomized rounds on the virtual hardware, back to back like at the
+// field: pick a mode and settings on the keypad, press and release plant
+// and defuse at random times, then '#' for the next round. Every loop()
+// iteration is checked against the rules of the game; the first violation
+// stops the run and prints the round's seed. Running that seed as a single
+// round replays it from a fresh boot, except that a round which quick
+// started goes through the setup prompts instead.
+//
+//   program --scenarios <rounds> [seed]
+
+struct ScenarioResult
+{
+  unsigned long rounds;
+  unsigned long failures;
+  unsigned long outcomes[3]; // time over, exploded, defused
+  unsigned long long virtualMillis;
+  double seconds; // wall clock
+};
+
+// Returns false when a round broke an invariant
+boolean scenarioRun(unsigned long rounds, uint32_t seed, ScenarioResult &result);
+
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+#include "scheduler.h"
+#include "hal.h"
+#include "log.h"
+
+#define NOT_QUEUED 0xFF
+
+struct Timer
+{
+  void (*callback)();
+  unsigned long intervalMillis;
+  unsigned long deadlineMillis;
+  uint8_t heapIndex;
+};
+
+static Timer timers[SCHEDULER_CAPACITY];
+static uint8_t timerCount;
+static uint8_t refused;
+
+static SchedulerTimer heap[SCHEDULER_CAPACITY];
+static uint8_t heapSize;
+
+// Wrap safe: true when a is due before b
+static boolean earlier(SchedulerTimer a, SchedulerTimer b)
+{
+  return (long)(timers[a].deadlineMillis - timers[b].deadlineMillis) < 0;
+}
+
+static void place(uint8_t index, SchedulerTimer timer)
+{
+  heap[index] = timer;
+  timers[timer].heapIndex = index;
+}
+
+static void siftUp(uint8_t index)
+{
+  SchedulerTimer timer = heap[index];
+  while (index > 0)
+  {
+    uint8_t parent = (index - 1) / 2;
+    if (!earlier(timer, heap[parent]))
+    {
+      break;
+    }
+    place(index, heap[parent]);
+    index = parent;
+  }
+  place(index, timer);
+}
+
+static void siftDown(uint8_t index)
+{
+  SchedulerTimer timer = heap[index];
+  while (true)
+  {
+    uint8_t child = index * 2 + 1;
+    if (child >= heapSize)
+    {
+      break;
+    }
+    if (child + 1 < heapSize && earlier(heap[child + 1], heap[child]))
+    {
+      child++;
+    }
+    if (!earlier(heap[child], timer))
+    {
+      break;
+    }
+    place(index, heap[child]);
+    index = child;
+  }
+  place(index, timer);
+}
+
+// Restores the heap after the deadline of a queued timer changed
+static void reposition(SchedulerTimer timer)
+{
+  uint8_t index = timers[timer].heapIndex;
+  if (index > 0 && earlier(timer, heap[(index - 1) / 2]))
+  {
+    siftUp(index);
+  }
+  else
+  {
+    siftDown(index);
+  }
+}
+
+static boolean valid(SchedulerTimer timer)
+{
+  return timer < timerCount;
+}
+
+SchedulerTimer schedulerCreate(void (*callback)(), unsigned long intervalMillis)
+{
+  if (timerCount >= SCHEDULER_CAPACITY)
+  {
+    refused++;
+    LOG_ERROR(SETUP, LOG_SCHEDULER_FULL, refused, SCHEDULER_CAPACITY);
+    return SCHEDULER_INVALID;
+  }
+
+  SchedulerTimer timer = timerCount++;
+  timers[timer].callback = callback;
+  timers[timer].intervalMillis = intervalMillis;
+  timers[timer].heapIndex = NOT_QUEUED;
+  return timer;
+}
+
+uint8_t schedulerRefused()
+{
+  return refused;
+}
+
+void schedulerStart(SchedulerTimer timer)
+{
+  if (!valid(timer))
+  {
+    return;
+  }
+
+  timers[timer].deadlineMillis = halMillis() + timers[timer].intervalMillis;
+
+  if (timers[timer].heapIndex == NOT_QUEUED)
+  {
+    place(heapSize, timer);
+    heapSize++;
+    siftUp(heapSize - 1);
+  }
+  else
+  {
+    reposition(timer);
+  }
+}
+
+void schedulerStop(SchedulerTimer timer)
+{
+  if (!valid(timer))
+  {
+    return;
+  }
+
+  uint8_t index = timers[timer].heapIndex;
+  if (index == NOT_QUEUED)
+  {
+    return;
+  }
+
+  timers[timer].heapIndex = NOT_QUEUED;
+  heapSize--;
+  if (index < heapSize)
+  {
+    place(index, heap[heapSize]);
+    reposition(heap[index]);
+  }
+}
+
+boolean schedulerRunning(SchedulerTimer timer)
+{
+  return valid(timer) && timers[timer].heapIndex != NOT_QUEUED;
+}
+
+void schedulerSetInterval(SchedulerTimer timer, unsigned long intervalMillis)
+{
+  if (!valid(timer))
+  {
+    return;
+  }
+
+  Timer &entry = timers[timer];
+  if (entry.intervalMillis == intervalMillis)
+  {
+    return;
+  }
+
+  if (entry.heapIndex != NOT_QUEUED)
+  {
+    entry.deadlineMillis = entry.deadlineMillis - entry.intervalMillis + intervalMillis;
+    entry.intervalMillis = intervalMillis;
+    reposition(timer);
+  }
+  else
+  {
+    entry.intervalMillis = intervalMillis;
+  }
+}
+
+void schedulerUpdate()
+{
+  if (heapSize == 0)
+  {
+    return;
+  }
+
+  unsigned long now = halMillis();
+  while (heapSize > 0 && (long)(now - timers[heap[0]].deadlineMillis) >= 0)
+  {
+    // Requeue before the call so the callback is free to stop or restart it
+    SchedulerTimer timer = heap[0];
+    timers[timer].deadlineMillis = now + timers[timer].intervalMillis;
+    siftDown(0);
+    timers[timer].callback();
+  }
+}
+
+unsigned long schedulerMillisUntilNext()
+{
+  if (heapSize == 0)
+  {
+    return SCHEDULER_IDLE_FOREVER;
+  }
+
+  long remaining = timers[heap[0]].deadlineMillis - halMillis();
+  return remaining > 0 ? remaining : 0;
+}
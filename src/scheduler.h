@@ -0,0 +1,40 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Periodic timers kept in a binary min-heap ordered by deadline, all of it
+// in a fixed static pool. schedulerUpdate() only compares the clock with the
+// root of the heap when nothing is due, whatever the number of timers, and
+// stopped timers cost nothing at all.
+//
+// Timers behave like the Ticker library did: the first call comes one
+// interval after start, and the next deadline is counted from the time the
+// callback actually ran.
+
+#define SCHEDULER_CAPACITY 8
+#define SCHEDULER_IDLE_FOREVER 0xFFFFFFFFUL
+// Handed out once the pool is full; the calls below ignore it
+#define SCHEDULER_INVALID 0xFF
+
+typedef uint8_t SchedulerTimer;
+
+// Meant for global initializers, timers are never released. Returns
+// SCHEDULER_INVALID and logs an error past SCHEDULER_CAPACITY.
+SchedulerTimer schedulerCreate(void (*callback)(), unsigned long intervalMillis);
+// Timers refused so far. Global initializers run before Serial is up, so
+// setup() logs this again.
+uint8_t schedulerRefused();
+
+void schedulerStart(SchedulerTimer timer);
+void schedulerStop(SchedulerTimer timer);
+boolean schedulerRunning(SchedulerTimer timer);
+// Moves the pending deadline along with the interval, like Ticker::interval()
+void schedulerSetInterval(SchedulerTimer timer, unsigned long intervalMillis);
+
+// Runs every callback that is due
+void schedulerUpdate();
+// 0 when something is due, SCHEDULER_IDLE_FOREVER when nothing is running
+unsigned long schedulerMillisUntilNext();
+
+#endif
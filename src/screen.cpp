@@ -0,0 +1,152 @@
+#include "screen.h"
+#include "config.h"
+#include "hal.h"
+
+#define SCREEN_PAGES 8
+#define PAGES_PER_LINE 2
+
+// SSD1306AsciiAvrI2c sends each cursor command in its own transaction
+// (address, control, command) and batches data bytes 16 at a time behind
+// an address and a control byte. Good enough to compare strategies.
+#define CURSOR_BYTES 9
+#define DATA_BATCH 16
+
+struct ScreenLine
+{
+  char text[SCREEN_LINE_CHARS + 1];
+  uint8_t x;
+};
+
+static ScreenLine shown[SCREEN_LINES];
+static ScreenStats stats;
+
+static unsigned long dataBytes(unsigned int count)
+{
+  return count + 2UL * ((count + DATA_BATCH - 1) / DATA_BATCH);
+}
+
+static unsigned long pageWriteBytes(unsigned int columns)
+{
+  return CURSOR_BYTES + dataBytes(columns);
+}
+
+static uint8_t columnOf(uint8_t x, uint8_t index)
+{
+  unsigned int column = x + (unsigned int)index * SCREEN_CHAR_WIDTH;
+  return column < SCREEN_WIDTH ? column : SCREEN_WIDTH;
+}
+
+static unsigned long clearColumns(uint8_t line, uint8_t fromColumn, uint8_t toColumn)
+{
+  if (fromColumn >= toColumn)
+  {
+    return 0;
+  }
+
+  uint8_t page = line * PAGES_PER_LINE;
+  halOledClearRegion(fromColumn, toColumn - 1, page, page + PAGES_PER_LINE - 1);
+  return PAGES_PER_LINE * pageWriteBytes(toColumn - fromColumn);
+}
+
+static unsigned long writeText(uint8_t line, const char *text, uint8_t x)
+{
+  uint8_t length = strlen(text);
+  if (length == 0 || x >= SCREEN_WIDTH)
+  {
+    return 0;
+  }
+
+  halOledText(text, x, line * PAGES_PER_LINE, true);
+  return PAGES_PER_LINE * pageWriteBytes(columnOf(x, length) - x);
+}
+
+static unsigned long updateLine(uint8_t line, const char *text, uint8_t x)
+{
+  ScreenLine &current = shown[line];
+  uint8_t oldLength = strlen(current.text);
+  uint8_t newLength = strlen(text);
+  if (newLength > SCREEN_LINE_CHARS)
+  {
+    newLength = SCREEN_LINE_CHARS;
+  }
+
+  uint8_t firstDifference = 0;
+  if (current.x == x)
+  {
+    while (firstDifference < oldLength && firstDifference < newLength && current.text[firstDifference] == text[firstDifference])
+    {
+      firstDifference++;
+    }
+
+    if (firstDifference == oldLength && oldLength == newLength)
+    {
+      return 0;
+    }
+  }
+
+  unsigned long bytes = 0;
+  if (current.x == x)
+  {
+    // Same origin: the shared prefix stays, only the tail is rewritten
+    bytes += writeText(line, text + firstDifference, columnOf(x, firstDifference));
+    bytes += clearColumns(line, columnOf(x, newLength), columnOf(x, oldLength));
+  }
+  else
+  {
+    bytes += clearColumns(line, columnOf(current.x, 0), columnOf(current.x, oldLength));
+    bytes += writeText(line, text, x);
+  }
+
+  memcpy(current.text, text, newLength);
+  current.text[newLength] = '\0';
+  current.x = x;
+  return bytes;
+}
+
+void screenBegin()
+{
+  halOledClear();
+  memset(shown, 0, sizeof(shown));
+  memset(&stats, 0, sizeof(stats));
+}
+
+void screenShow_P(const ScreenDescriptor *screen)
+{
+  unsigned long start = halMicros();
+  unsigned long bytes = 0;
+  unsigned long fullRedrawBytes = SCREEN_PAGES * pageWriteBytes(SCREEN_WIDTH);
+  char text[SCREEN_LINE_CHARS + 1];
+
+  for (uint8_t line = 0; line < SCREEN_LINES; line++)
+  {
+    memcpy_P(text, screen->text[line], sizeof(text));
+    uint8_t x = pgm_read_byte(&screen->x[line]);
+    bytes += updateLine(line, text, x);
+
+    uint8_t length = strlen(text);
+    if (length > 0)
+    {
+      fullRedrawBytes += PAGES_PER_LINE * pageWriteBytes(columnOf(x, length) - x);
+    }
+  }
+
+  stats.lastMicros = halMicros() - start;
+  stats.lastBytes = bytes;
+  stats.lastFullRedrawBytes = fullRedrawBytes;
+  stats.bytes += bytes;
+  stats.fullRedrawBytes += fullRedrawBytes;
+  stats.updates++;
+}
+
+void screenShowLine(uint8_t line, const char *text, uint8_t x)
+{
+  if (line < SCREEN_LINES)
+  {
+    stats.bytes += updateLine(line, text, x);
+  }
+}
+
+const ScreenStats &screenStats()
+{
+  return stats;
+}
@@ -0,0 +1,40 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <Arduino.h>
+
+// Keeps a copy of the four 2X text lines shown on the SSD1306 and only sends
+// what changed. A line that keeps its x offset is rewritten from its first
+// different character, and the columns it no longer covers are cleared;
+// untouched lines cost nothing. Line n covers pages 2n and 2n+1.
+
+#define SCREEN_LINES 4
+#define SCREEN_LINE_CHARS 16
+#define SCREEN_WIDTH 128
+#define SCREEN_CHAR_WIDTH 12 // Adafruit5x7 at 2X: (5 + 1) * 2 columns
+
+// A fixed screen, meant to live in PROGMEM
+struct ScreenDescriptor
+{
+  char text[SCREEN_LINES][SCREEN_LINE_CHARS + 1];
+  uint8_t x[SCREEN_LINES];
+};
+
+struct ScreenStats
+{
+  unsigned long updates;
+  unsigned long bytes;           // estimated I2C bytes sent
+  unsigned long fullRedrawBytes; // what clear() plus a full redraw would have sent
+  unsigned long lastBytes;
+  unsigned long lastFullRedrawBytes;
+  unsigned long lastMicros; // blocking time of the last update
+};
+
+void screenBegin();
+// Renders a screen straight from flash, no heap involved
+void screenShow_P(const ScreenDescriptor *screen);
+// Replaces a single line, for text built at run time
+void screenShowLine(uint8_t line, const char *text, uint8_t x);
+const ScreenStats &screenStats();
+
+#endif
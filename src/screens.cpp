@@ -0,0 +1,18 @@
+#include "screens.h"
+
+const ScreenDescriptor SCREEN_MAIN_MENU PROGMEM = {{"1.Search &", "Destroy", "2.Sabotage", "3-9.Quick"}, {0, 15, 0, 0}};
+const ScreenDescriptor SCREEN_GAME_LENGTH_PROMPT PROGMEM = {{"Game Length", "in minutes?", "#-> OK", "*-> Cancel"}, {0, 0, 0, 0}};
+const ScreenDescriptor SCREEN_PLANT_TIME_PROMPT PROGMEM = {{"Bomb Plant", "in seconds?", "#-> OK", "*-> Cancel"}, {0, 0, 0, 0}};
+const ScreenDescriptor SCREEN_BOMB_TIME_PROMPT PROGMEM = {{"Bomb time", "in minutes?", "#-> OK", "*-> Cancel"}, {0, 0, 0, 0}};
+const ScreenDescriptor SCREEN_DEFUSE_TIME_PROMPT PROGMEM = {{"Defuse time", "in seconds?", "#-> OK", "*-> Cancel"}, {0, 0, 0, 0}};
+const ScreenDescriptor SCREEN_DEFUSE_CODE_PROMPT PROGMEM = {{"Defusing", "code?", "#-> OK", "*-> Cancel"}, {0, 0, 0, 0}};
+const ScreenDescriptor SCREEN_START_GAME_PROMPT PROGMEM = {{"Start game?", "", "#-> OK", "*-> Cancel"}, {0, 0, 0, 0}};
+const ScreenDescriptor SCREEN_STARTING_GAME PROGMEM = {{"", "Starting", "game", ""}, {0, 10, 40, 0}};
+const ScreenDescriptor SCREEN_GO PROGMEM = {{"", "", "GO!", ""}, {0, 0, 55, 0}};
+const ScreenDescriptor SCREEN_GAME_RUNNING PROGMEM = {{"Game", "running", "Plant", "the bomb"}, {40, 20, 30, 15}};
+const ScreenDescriptor SCREEN_PLANTING PROGMEM = {{"Planting", "the bomb", "Please", "wait"}, {10, 20, 30, 40}};
+const ScreenDescriptor SCREEN_BOMB_PLANTED PROGMEM = {{"The Bomb ", "has been", "planted", ""}, {15, 15, 15, 0}};
+const ScreenDescriptor SCREEN_DEFUSING PROGMEM = {{"Defusing", "bomb.", "Please", "wait"}, {15, 40, 30, 40}};
+const ScreenDescriptor SCREEN_TIME_OVER PROGMEM = {{"", "TIME OVER", "", ""}, {0, 10, 20, 30}};
+const ScreenDescriptor SCREEN_COUNTER_WIN PROGMEM = {{"", "Counter", "WIN", ""}, {0, 30, 50, 30}};
+const ScreenDescriptor SCREEN_TERRORIST_WIN PROGMEM = {{"", "Terrorist", "WIN", ""}, {0, 10, 50, 30}};
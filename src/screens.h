@@ -0,0 +1,25 @@
+#ifndef SCREENS_H
+#define SCREENS_H
+
+#include "screen.h"
+
+// Every fixed screen of the game, kept in flash and rendered by screenShow_P()
+
+extern const ScreenDescriptor SCREEN_MAIN_MENU PROGMEM;
+extern const ScreenDescriptor SCREEN_GAME_LENGTH_PROMPT PROGMEM;
+extern const ScreenDescriptor SCREEN_PLANT_TIME_PROMPT PROGMEM;
+extern const ScreenDescriptor SCREEN_BOMB_TIME_PROMPT PROGMEM;
+extern const ScreenDescriptor SCREEN_DEFUSE_TIME_PROMPT PROGMEM;
+extern const ScreenDescriptor SCREEN_DEFUSE_CODE_PROMPT PROGMEM;
+extern const ScreenDescriptor SCREEN_START_GAME_PROMPT PROGMEM;
+extern const ScreenDescriptor SCREEN_STARTING_GAME PROGMEM;
+extern const ScreenDescriptor SCREEN_GO PROGMEM;
+extern const ScreenDescriptor SCREEN_GAME_RUNNING PROGMEM;
+extern const ScreenDescriptor SCREEN_PLANTING PROGMEM;
+extern const ScreenDescriptor SCREEN_BOMB_PLANTED PROGMEM;
+extern const ScreenDescriptor SCREEN_DEFUSING PROGMEM;
+extern const ScreenDescriptor SCREEN_TIME_OVER PROGMEM;
+extern const ScreenDescriptor SCREEN_COUNTER_WIN PROGMEM;
+extern const ScreenDescriptor SCREEN_TERRORIST_WIN PROGMEM;
+
+#endif
@@ -0,0 +1,146 @@
+#include "setupWizard.h"
+#include "main.h"
+#include "hal.h"
+#include "screens.h"
+#include "scheduler.h"
+#include "log.h"
+#include "numberEntry.h"
+
+static const WizardStep *steps;
+static uint8_t stepIndex;
+static WizardStep step;
+static void (*finishedCallback)();
+static void (*cancelledCallback)();
+
+static NumberEntry input;
+static unsigned long countdownEndMillis;
+static uint8_t displayedSecond;
+
+static void enterStep(uint8_t index)
+{
+  stepIndex = index;
+  memcpy_P(&step, &steps[stepIndex], sizeof(WizardStep));
+  numberEntryBegin(input, step.minimum, step.maximum);
+
+  switch (step.kind)
+  {
+  case WIZARD_NUMBER:
+  case WIZARD_CONFIRM:
+    displayScreen(step.screen);
+    break;
+
+  case WIZARD_COUNTDOWN:
+    LOG_INFO(GAME, LOG_WIZARD_START);
+    countdownEndMillis = halMillis() + WIZARD_COUNTDOWN_MILLIS;
+    displayedSecond = WIZARD_COUNTDOWN_MILLIS / 1000;
+    displayScreen(step.screen);
+    break;
+
+  case WIZARD_DONE:
+    steps = NULL;
+    finishedCallback();
+    break;
+  }
+}
+
+void wizardStart(const WizardStep *wizardSteps, void (*onFinished)(), void (*onCancelled)())
+{
+  steps = wizardSteps;
+  finishedCallback = onFinished;
+  cancelledCallback = onCancelled;
+  enterStep(0);
+}
+
+boolean wizardActive()
+{
+  return steps != NULL;
+}
+
+void wizardKey(char key)
+{
+  if (steps == NULL)
+  {
+    return;
+  }
+
+  if (key == '*' && step.kind == WIZARD_NUMBER && !numberEntryEmpty(input))
+  {
+    key = NUMBER_ENTRY_BACKSPACE;
+  }
+  else if (key == '*')
+  {
+    steps = NULL;
+    clearLedDisplay();
+    cancelledCallback();
+    return;
+  }
+
+  switch (step.kind)
+  {
+  case WIZARD_NUMBER:
+    if (key == '#')
+    {
+      if (!numberEntryEmpty(input))
+      {
+        LOG_INFO(SETUP, LOG_WIZARD_INPUT, numberEntryValue(input));
+        clearLedDisplay();
+        *step.field = numberEntryValue(input);
+        enterStep(stepIndex + 1);
+      }
+    }
+    else if (numberEntryKey(input, key))
+    {
+      if (numberEntryEmpty(input))
+      {
+        clearLedDisplay();
+      }
+      else
+      {
+        displayLedNumber(numberEntryValue(input));
+      }
+    }
+    break;
+
+  case WIZARD_CONFIRM:
+    if (key == '#')
+    {
+      enterStep(stepIndex + 1);
+    }
+    break;
+  }
+}
+
+void wizardUpdate()
+{
+  if (steps == NULL || step.kind != WIZARD_COUNTDOWN)
+  {
+    return;
+  }
+
+  long remaining = countdownEndMillis - halMillis();
+  uint8_t currentSecond = remaining > 0 ? remaining / 1000 : 0;
+
+  if (displayedSecond != currentSecond)
+  {
+    displayedSecond = currentSecond;
+    displayLedCountdown(0, currentSecond);
+  }
+
+  if (currentSecond == 0)
+  {
+    displayScreen(&SCREEN_GO);
+    enterStep(stepIndex + 1);
+  }
+}
+
+unsigned long wizardMillisUntilNext()
+{
+  if (steps == NULL || step.kind != WIZARD_COUNTDOWN)
+  {
+    return SCHEDULER_IDLE_FOREVER;
+  }
+
+  // The displayed second changes when the remaining time crosses a boundary
+  long remaining = countdownEndMillis - halMillis();
+  return remaining > 0 ? remaining % 1000 + 1 : 0;
+}
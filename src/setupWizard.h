@@ -0,0 +1,42 @@
+#ifndef SETUP_WIZARD_H
+#define SETUP_WIZARD_H
+
+#include <Arduino.h>
+
+struct ScreenDescriptor;
+
+// Game setup as a resumable state machine. Each step shows its prompt and
+// then only reacts to the keys handed to wizardKey(); wizardUpdate() runs
+// the start countdown from loop(). Nothing in here waits, so loop() keeps
+// running while the referee is typing. '*' cancels the wizard, except
+// while a number has digits, where it erases the last one.
+
+enum WizardStepKind
+{
+  WIZARD_NUMBER,    // digits, '#' accepts, stored into field clamped to its range
+  WIZARD_CONFIRM,   // '#' accepts
+  WIZARD_COUNTDOWN, // 10 s countdown on the LED display
+  WIZARD_DONE,
+};
+
+struct WizardStep
+{
+  uint8_t kind;
+  const ScreenDescriptor *screen;
+  uint8_t *field;
+  uint8_t minimum; // WIZARD_NUMBER only
+  uint8_t maximum;
+};
+
+#define WIZARD_COUNTDOWN_MILLIS 10000UL
+
+// steps is a PROGMEM array ending with a WIZARD_DONE step. onFinished runs
+// after the last step, onCancelled when '*' is pressed.
+void wizardStart(const WizardStep *steps, void (*onFinished)(), void (*onCancelled)());
+boolean wizardActive();
+void wizardKey(char key);
+void wizardUpdate();
+// How long loop() may idle before the countdown needs attention
+unsigned long wizardMillisUntilNext();
+
+#endif
@@ -0,0 +1,130 @@
+#ifdef ARDUINO
+
+#include "soundCache.h"
+#include "soundCatalog.h"
+#include "sounds.h"
+#include "config.h"
+#include "log.h"
+
+// Samples this close to the 8 bit midpoint count as silence when trimming
+#define SILENCE_THRESHOLD 2
+#define SCAN_CHUNK_BYTES 64
+
+struct CachedClip
+{
+  uint16_t offset;
+  uint16_t length; // 0 when not cached
+};
+
+static uint8_t cache[SOUND_CACHE_BYTES];
+static CachedClip cachedClips[SOUND_COUNT];
+static SoundCacheStats stats;
+
+static boolean silent(uint8_t sample)
+{
+  return sample >= 128 - SILENCE_THRESHOLD && sample <= 128 + SILENCE_THRESHOLD;
+}
+
+// Finds the audible part of the clip as [first, end) in bytes from its
+// first sample. The file is left somewhere past the data.
+static boolean findAudible(FsFile &file, uint32_t dataBytes, uint32_t &first, uint32_t &end)
+{
+  uint8_t chunk[SCAN_CHUNK_BYTES];
+  first = dataBytes;
+  end = 0;
+
+  uint32_t position = 0;
+  while (position < dataBytes)
+  {
+    uint32_t wanted = dataBytes - position;
+    int read = file.read(chunk, wanted < SCAN_CHUNK_BYTES ? wanted : SCAN_CHUNK_BYTES);
+    if (read <= 0)
+    {
+      return false;
+    }
+
+    for (int i = 0; i < read; i++)
+    {
+      if (!silent(chunk[i]))
+      {
+        if (first == dataBytes)
+        {
+          first = position + i;
+        }
+        end = position + i + 1;
+      }
+    }
+    position += read;
+  }
+
+  return end > first;
+}
+
+static boolean load(uint8_t sound)
+{
+  const SoundClip *clip = soundCatalogClip(sound);
+  FsFile file;
+  if (clip == NULL || !soundCatalogOpen(sound, file))
+  {
+    return false;
+  }
+
+  uint32_t first, end;
+  boolean loaded = false;
+  if (findAudible(file, clip->dataBytes, first, end) && end - first <= (uint32_t)(SOUND_CACHE_BYTES - stats.bytesUsed) && file.seekSet(clip->dataOffset + first))
+  {
+    uint16_t length = end - first;
+    if (file.read(cache + stats.bytesUsed, length) == (int)length)
+    {
+      cachedClips[sound].offset = stats.bytesUsed;
+      cachedClips[sound].length = length;
+      stats.bytesUsed += length;
+      loaded = true;
+    }
+  }
+  file.close();
+
+  if (loaded)
+  {
+    LOG_INFO(SOUND, LOG_SOUND_CACHED, sound, cachedClips[sound].length, clip->dataBytes);
+  }
+  else
+  {
+    // Without sounds.pak the WAV fallback clips are not trimmed and the key
+    // click ends up here
+    LOG_WARN(SOUND, LOG_SOUND_NOT_CACHED, sound, SOUND_CACHE_BYTES - stats.bytesUsed, SOUND_CACHE_BYTES);
+  }
+
+  return loaded;
+}
+
+void soundCacheBegin()
+{
+  memset(cachedClips, 0, sizeof(cachedClips));
+  memset(&stats, 0, sizeof(stats));
+
+  for (uint8_t i = 0; i < CACHED_SOUND_COUNT; i++)
+  {
+    load(pgm_read_byte(&CACHED_SOUNDS[i]));
+  }
+}
+
+const uint8_t *soundCacheLookup(uint8_t sound, uint16_t &length)
+{
+  if (sound >= SOUND_COUNT || cachedClips[sound].length == 0)
+  {
+    stats.misses++;
+    return NULL;
+  }
+
+  stats.hits++;
+  length = cachedClips[sound].length;
+  return cache + cachedClips[sound].offset;
+}
+
+const SoundCacheStats &soundCacheStats()
+{
+  return stats;
+}
+
+#endif
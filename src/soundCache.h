@@ -0,0 +1,28 @@
+#ifndef SOUND_CACHE_H
+#define SOUND_CACHE_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+
+// Short clips kept in RAM so they play without touching the card. The clips
+// in CACHED_SOUNDS (sounds.h) are loaded in order when the catalog is built,
+// each trimmed of the silence at both ends, for as long as they fit in
+// SOUND_CACHE_BYTES. Anything that does not fit keeps streaming and is
+// logged at setup; tools/buildSoundPack.py checks the same against the pack.
+
+struct SoundCacheStats
+{
+  unsigned long hits;
+  unsigned long misses;
+  uint16_t bytesUsed;
+};
+
+void soundCacheBegin();
+// Samples of a cached clip, or NULL when it has to be streamed
+const uint8_t *soundCacheLookup(uint8_t sound, uint16_t &length);
+const SoundCacheStats &soundCacheStats();
+
+#endif
+
+#endif
@@ -0,0 +1,198 @@
+#ifdef ARDUINO
+
+#include "soundCatalog.h"
+#include "sounds.h"
+#include "config.h"
+#include "log.h"
+
+#define SOUND_FILE_NAME_MAX 32
+#define MAX_SAMPLE_RATE 44100
+#define SECTOR_BYTES 512
+
+// Sound pack layout, see tools/buildSoundPack.py
+#define PACK_VERSION 1
+#define PACK_HEADER_BYTES 16
+#define PACK_ENTRY_BYTES 16
+
+extern SdFat sd;
+
+static SoundClip clips[SOUND_COUNT];
+static FsFile root;
+
+static uint16_t readUint16(const uint8_t *bytes)
+{
+  return bytes[0] | ((uint16_t)bytes[1] << 8);
+}
+
+static uint32_t readUint32(const uint8_t *bytes)
+{
+  return readUint16(bytes) | ((uint32_t)readUint16(bytes + 2) << 16);
+}
+
+// Walks the RIFF chunks up to "data" and keeps the format and where the
+// samples start. Only mono 8 bit PCM is accepted, which is what the player
+// writes to the speaker.
+static boolean readWaveHeader(FsFile &file, SoundClip &clip)
+{
+  uint8_t chunk[16];
+  if (file.read(chunk, 12) != 12 || memcmp_P(chunk, PSTR("RIFF"), 4) != 0 || memcmp_P(chunk + 8, PSTR("WAVE"), 4) != 0)
+  {
+    return false;
+  }
+
+  boolean formatSupported = false;
+  while (file.read(chunk, 8) == 8)
+  {
+    uint32_t size = readUint32(chunk + 4);
+    uint32_t padded = size + (size & 1); // chunks are word aligned
+
+    if (memcmp_P(chunk, PSTR("data"), 4) == 0)
+    {
+      uint32_t available = file.fileSize() - file.curPosition();
+      clip.dataOffset = file.curPosition();
+      clip.dataBytes = size < available ? size : available;
+      return formatSupported;
+    }
+
+    if (memcmp_P(chunk, PSTR("fmt "), 4) == 0)
+    {
+      if (size < 16 || file.read(chunk, 16) != 16)
+      {
+        return false;
+      }
+
+      uint32_t sampleRate = readUint32(chunk + 4);
+      formatSupported = readUint16(chunk) == 1       // PCM
+                        && readUint16(chunk + 2) == 1 // mono
+                        && readUint16(chunk + 14) == 8 && sampleRate > 0 && sampleRate <= MAX_SAMPLE_RATE;
+      clip.sampleRate = sampleRate;
+      padded -= 16;
+    }
+
+    if (!file.seekCur(padded))
+    {
+      return false;
+    }
+  }
+
+  return false;
+}
+
+// Fills the catalog from the sound pack. Only a contiguous pack built for
+// this firmware's SoundId list is used.
+static boolean loadPack()
+{
+  FsFile pack;
+  if (!pack.open(&root, SOUND_PACK_FILE, O_RDONLY))
+  {
+    return false;
+  }
+
+  uint8_t bytes[PACK_ENTRY_BYTES];
+  uint32_t firstSector, lastSector;
+  boolean loaded = pack.read(bytes, PACK_HEADER_BYTES) == PACK_HEADER_BYTES && memcmp_P(bytes, PSTR("BSPK"), 4) == 0 && readUint16(bytes + 4) == PACK_VERSION && readUint16(bytes + 6) == SOUND_COUNT && pack.contiguousRange(&firstSector, &lastSector);
+
+  uint16_t sampleRate = readUint32(bytes + 8);
+  for (uint8_t sound = 0; loaded && sound < SOUND_COUNT; sound++)
+  {
+    if (pack.read(bytes, PACK_ENTRY_BYTES) != PACK_ENTRY_BYTES)
+    {
+      loaded = false;
+      break;
+    }
+
+    SoundClip &clip = clips[sound];
+    clip.firstSector = firstSector;
+    clip.dataOffset = readUint32(bytes) * SECTOR_BYTES;
+    clip.dataBytes = readUint32(bytes + 4);
+    clip.gain = bytes[8];
+    clip.sampleRate = sampleRate;
+    clip.dirIndex = pack.dirIndex();
+    clip.flags = clip.dataBytes > 0 ? SOUND_CLIP_PRESENT | SOUND_CLIP_CONTIGUOUS : 0;
+  }
+  pack.close();
+
+  if (loaded)
+  {
+    LOG_INFO(SOUND, LOG_SOUND_PACK_LOADED, SOUND_COUNT, sampleRate);
+  }
+  else
+  {
+    memset(clips, 0, sizeof(clips));
+    LOG_WARN(SOUND, LOG_SOUND_PACK_UNUSABLE);
+  }
+  return loaded;
+}
+
+void soundCatalogBegin()
+{
+  memset(clips, 0, sizeof(clips));
+  root.close();
+  if (!root.open("/"))
+  {
+    return;
+  }
+
+  if (loadPack())
+  {
+    return;
+  }
+
+  char name[SOUND_FILE_NAME_MAX];
+  for (uint8_t sound = 0; sound < SOUND_COUNT; sound++)
+  {
+    strncpy_P(name, soundFileName(sound), SOUND_FILE_NAME_MAX - 1);
+    name[SOUND_FILE_NAME_MAX - 1] = '\0';
+
+    FsFile file;
+    if (!file.open(&root, name, O_RDONLY))
+    {
+      continue;
+    }
+
+    SoundClip &clip = clips[sound];
+    if (readWaveHeader(file, clip))
+    {
+      clip.dirIndex = file.dirIndex();
+      clip.gain = SOUND_GAIN_UNITY;
+      clip.flags = SOUND_CLIP_PRESENT;
+
+      uint32_t lastSector;
+      if (file.contiguousRange(&clip.firstSector, &lastSector))
+      {
+        clip.flags |= SOUND_CLIP_CONTIGUOUS;
+      }
+    }
+    file.close();
+
+    if (!(clip.flags & SOUND_CLIP_PRESENT))
+    {
+      LOG_WARN(SOUND, LOG_SOUND_FILE_UNSUPPORTED, sound);
+    }
+    else if (!(clip.flags & SOUND_CLIP_CONTIGUOUS))
+    {
+      LOG_WARN(SOUND, LOG_SOUND_FILE_FRAGMENTED, sound, clip.dataBytes, clip.sampleRate);
+    }
+    else
+    {
+      LOG_INFO(SOUND, LOG_SOUND_FILE, sound, clip.dataBytes, clip.sampleRate);
+    }
+  }
+}
+
+const SoundClip *soundCatalogClip(uint8_t sound)
+{
+  if (sound >= SOUND_COUNT || !(clips[sound].flags & SOUND_CLIP_PRESENT))
+  {
+    return NULL;
+  }
+  return &clips[sound];
+}
+
+boolean soundCatalogOpen(uint8_t sound, FsFile &file)
+{
+  const SoundClip *clip = soundCatalogClip(sound);
+  return clip != NULL && file.open(&root, clip->dirIndex, O_RDONLY) && file.seekSet(clip->dataOffset);
+}
+
+#endif
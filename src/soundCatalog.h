@@ -0,0 +1,46 @@
+#ifndef SOUND_CATALOG_H
+#define SOUND_CATALOG_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+// Index of the clips in sounds.h, built once when the SD card comes up.
+// Each entry remembers where the samples start on the card, so playback
+// never searches the FAT directory. Contiguous files are read sector by
+// sector straight from the card; fragmented ones are reopened by their
+// directory index and read through the file system.
+//
+// The clips come from the sound pack when the card has one (see
+// tools/buildSoundPack.py), otherwise from one WAV file per clip.
+
+#define SOUND_PACK_FILE "sounds.pak"
+#define SOUND_GAIN_UNITY 128
+
+enum SoundClipFlags
+{
+  SOUND_CLIP_PRESENT = 1,    // found, and a mono 8 bit PCM WAV
+  SOUND_CLIP_CONTIGUOUS = 2, // firstSector is valid
+};
+
+struct SoundClip
+{
+  uint32_t firstSector; // card sector holding the first byte of the file
+  uint32_t dataBytes;
+  uint32_t dataOffset; // first sample, in bytes from the start of the file
+  uint16_t sampleRate;
+  uint16_t dirIndex;
+  uint8_t gain; // applied at playback, SOUND_GAIN_UNITY is 1.0
+  uint8_t flags;
+};
+
+void soundCatalogBegin();
+// NULL when the clip is missing or in a format the player cannot output
+const SoundClip *soundCatalogClip(uint8_t sound);
+// Opens a fragmented clip positioned on its first sample
+boolean soundCatalogOpen(uint8_t sound, FsFile &file);
+
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#include "sounds.h"
+
+static const char KEY_CLICK[] PROGMEM = "nvg_off-15db.wav";
+static const char GO[] PROGMEM = "com_go-15.wav";
+static const char ENEMY_DOWN[] PROGMEM = "enemydown-15db.wav";
+static const char C4_PLANT[] PROGMEM = "c4_plant-15db.wav";
+static const char C4_DISARM[] PROGMEM = "c4_disarm-15db.wav";
+static const char C4_DISARMED[] PROGMEM = "c4_disarmed-15db.wav";
+static const char BOMB_PLANTED[] PROGMEM = "bombpl-15db.wav";
+static const char BOMB_DEFUSED[] PROGMEM = "bombdef-15db.wav";
+static const char EXPLOSION[] PROGMEM = "new_bomb_explosion-5db.wav";
+static const char COUNTER_WIN[] PROGMEM = "ctwin-15.wav";
+static const char TERRORIST_WIN[] PROGMEM = "terwin-15.wav";
+
+struct SoundInfo
+{
+  const char *fileName;
+  uint8_t priority;
+};
+
+// In SoundId order
+static const SoundInfo SOUNDS[SOUND_COUNT] PROGMEM = {
+    {KEY_CLICK, SOUND_PRIORITY_CLICK},
+    {GO, SOUND_PRIORITY_ANNOUNCEMENT},
+    {ENEMY_DOWN, SOUND_PRIORITY_EFFECT},
+    {C4_PLANT, SOUND_PRIORITY_EFFECT},
+    {C4_DISARM, SOUND_PRIORITY_EFFECT},
+    {C4_DISARMED, SOUND_PRIORITY_EFFECT},
+    {BOMB_PLANTED, SOUND_PRIORITY_ANNOUNCEMENT},
+    {BOMB_DEFUSED, SOUND_PRIORITY_ANNOUNCEMENT},
+    {EXPLOSION, SOUND_PRIORITY_OUTCOME},
+    {COUNTER_WIN, SOUND_PRIORITY_OUTCOME},
+    {TERRORIST_WIN, SOUND_PRIORITY_OUTCOME},
+};
+
+const uint8_t CACHED_SOUNDS[CACHED_SOUND_COUNT] PROGMEM = {
+    SOUND_KEY_CLICK, // every keypress
+};
+
+const char *soundFileName(uint8_t sound)
+{
+  return (const char *)pgm_read_ptr(&SOUNDS[sound].fileName);
+}
+
+uint8_t soundPriority(uint8_t sound)
+{
+  return pgm_read_byte(&SOUNDS[sound].priority);
+}
@@ -0,0 +1,46 @@
+#ifndef SOUNDS_H
+#define SOUNDS_H
+
+#include <Arduino.h>
+
+// Every clip the game plays. The IDs index the sound catalog the HAL builds
+// when the SD card comes up, so playing a sound never searches a directory.
+
+enum SoundId
+{
+  SOUND_KEY_CLICK,
+  SOUND_GO,
+  SOUND_ENEMY_DOWN,
+  SOUND_C4_PLANT,
+  SOUND_C4_DISARM,
+  SOUND_C4_DISARMED,
+  SOUND_BOMB_PLANTED,
+  SOUND_BOMB_DEFUSED,
+  SOUND_EXPLOSION,
+  SOUND_COUNTER_WIN,
+  SOUND_TERRORIST_WIN,
+  SOUND_COUNT
+};
+
+// When every voice that could play a clip is busy, the new clip takes over
+// the one with the lowest priority, provided that is not above its own
+enum SoundPriority
+{
+  SOUND_PRIORITY_CLICK,
+  SOUND_PRIORITY_EFFECT,
+  SOUND_PRIORITY_ANNOUNCEMENT,
+  SOUND_PRIORITY_OUTCOME,
+};
+
+// File name in the root of the SD card, a PROGMEM string
+const char *soundFileName(uint8_t sound);
+uint8_t soundPriority(uint8_t sound);
+
+// Clips to keep in RAM, most frequently played first. They are loaded in
+// this order until SOUND_CACHE_BYTES runs out; tools/buildSoundPack.py fails
+// when one of them would not fit. The plant and defuse clips (2.5 and 8.7 KB)
+// keep streaming, the SRAM is not there for them.
+#define CACHED_SOUND_COUNT 1
+extern const uint8_t CACHED_SOUNDS[CACHED_SOUND_COUNT] PROGMEM;
+
+#endif
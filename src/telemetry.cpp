@@ -0,0 +1,97 @@
+#include "telemetry.h"
+#include "hal.h"
+
+#define STATUS_BYTES 15
+#define CRC_BYTES 2
+// COBS adds one byte per 254 of data, plus the two delimiters
+#define MAX_FRAME_BYTES (TELEMETRY_MAX_PAYLOAD + CRC_BYTES + 1 + 2)
+
+static uint8_t sequence;
+static unsigned long dropped;
+
+static uint16_t crc16(const uint8_t *data, uint8_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Consistent overhead byte stuffing: every zero is replaced by the distance
+// to the next one, the first distance leads the frame. Returns the length
+// written to out, at most length + 1 for frames under 254 bytes.
+static uint8_t cobsEncode(const uint8_t *data, uint8_t length, uint8_t *out)
+{
+  uint8_t codeAt = 0;
+  uint8_t written = 1;
+  uint8_t code = 1;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    if (data[i] == 0)
+    {
+      out[codeAt] = code;
+      codeAt = written++;
+      code = 1;
+    }
+    else
+    {
+      out[written++] = data[i];
+      code++;
+    }
+  }
+  out[codeAt] = code;
+  return written;
+}
+
+static void putUint16(uint8_t *bytes, uint16_t value)
+{
+  bytes[0] = value;
+  bytes[1] = value >> 8;
+}
+
+boolean telemetrySendFrame(const uint8_t *payload, uint8_t length)
+{
+  uint8_t frameBytes = length + CRC_BYTES + 1 + 2;
+  // Checked first, so a dropped frame costs nothing more
+  if (length > TELEMETRY_MAX_PAYLOAD || Serial.availableForWrite() < frameBytes)
+  {
+    dropped++;
+    return false;
+  }
+
+  uint8_t data[TELEMETRY_MAX_PAYLOAD + CRC_BYTES];
+  memcpy(data, payload, length);
+  uint16_t crc = crc16(data, length);
+  data[length] = crc >> 8;
+  data[length + 1] = crc;
+
+  uint8_t frame[MAX_FRAME_BYTES];
+  frame[0] = 0;
+  uint8_t written = 1 + cobsEncode(data, length + CRC_BYTES, frame + 1);
+  frame[written++] = 0;
+  Serial.write(frame, written);
+  return true;
+}
+
+boolean telemetrySendStatus(const TelemetryStatus &status)
+{
+  uint8_t payload[STATUS_BYTES];
+  unsigned long now = halMillis();
+  payload[0] = TELEMETRY_STATUS;
+  payload[1] = sequence++;
+  putUint16(payload + 2, now);
+  putUint16(payload + 4, now >> 16);
+  payload[6] = status.runlevel;
+  payload[7] = status.menuLevel;
+  putUint16(payload + 8, status.secondsLeft);
+  payload[10] = status.buttons;
+  putUint16(payload + 11, status.freeMemory);
+  putUint16(payload + 13, dropped > 0xFFFF ? 0xFFFF : dropped);
+  return telemetrySendFrame(payload, STATUS_BYTES);
+}
@@ -0,0 +1,55 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// Binary status frames over Serial, for tools/telemetryViewer.py. A frame
+// is the payload followed by its CRC-16/CCITT (polynomial 0x1021, initial
+// value 0xFFFF, big endian), COBS encoded so it holds no zero byte, and
+// sent between two zero bytes. Any text printed between frames is skipped
+// by the receiver, so frames can share the port with plain text output.
+//
+// A frame is only queued when the whole of it fits in the Serial transmit
+// buffer; otherwise it is dropped and counted, so a slow or unplugged host
+// never stalls loop(). The first payload byte is the frame type.
+//
+// Status payload, little endian:
+//
+//    offset  size  field
+//    0       1     TELEMETRY_STATUS
+//    1       1     sequence number, wraps
+//    2       4     millis()
+//    6       1     Runtime
+//    7       1     MenuLevel
+//    8       2     seconds left on the running countdown, 0 when none
+//    10      1     buttons held, bit 0 plant, bit 1 defuse
+//    11      2     free memory in bytes
+//    13      2     frames dropped so far, of any type, saturating
+//
+// Log payload (log.h), little endian:
+//
+//    offset  size  field
+//    0       1     TELEMETRY_LOG
+//    1       1     level
+//    2       1     LogMessage
+//    3       4     millis()
+//    7       4*n   arguments, signed 32 bit, at most 3
+
+#define TELEMETRY_STATUS 1
+#define TELEMETRY_LOG 2
+#define TELEMETRY_MAX_PAYLOAD 19
+
+struct TelemetryStatus
+{
+  uint8_t runlevel;
+  uint8_t menuLevel;
+  uint16_t secondsLeft;
+  uint8_t buttons;
+  uint16_t freeMemory;
+};
+
+// False when the frame was dropped
+boolean telemetrySendFrame(const uint8_t *payload, uint8_t length);
+boolean telemetrySendStatus(const TelemetryStatus &status);
+
+#endif
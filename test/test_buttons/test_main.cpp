@@ -0,0 +1,105 @@
+// Unit tests for buttons.h on the virtual hardware, run with: pio test -e native
+//
+// The host HAL stamps an edge with the millisecond its pin changed and
+// applies it on the next clock read, so an edge that lands between the
+// clock reads of buttonsPoll() and its edge queue read is stamped after the
+// poll, as an edge caught by the Timer0 interrupt can be on the Mega.
+
+#include <unity.h>
+
+#include "buttons.h"
+#include "config.h"
+#include "halNative.h"
+
+void setUp()
+{
+  halNativeInit();
+  halNativeSetClockQuantumMicros(10);
+  buttonsBegin();
+}
+
+void tearDown()
+{
+}
+
+static void schedulePlant(unsigned long atMillis, uint8_t level)
+{
+  HalNativeEvent event = {atMillis, HAL_NATIVE_PIN, PLANT_BUTTON_PIN, (char)level};
+  halNativeSchedule(event);
+}
+
+// Leaves the clock 15 us before the millisecond of an edge: the poll reads
+// halMicros() still before it and halMillis() after it
+static void pressDuringPoll(unsigned long atMillis)
+{
+  halNativeAdvanceMicros(atMillis * 1000UL - 15);
+  schedulePlant(atMillis, HIGH);
+}
+
+static void test_edge_after_poll_time_is_not_in_the_past()
+{
+  pressDuringPoll(1000);
+
+  ButtonEvent event;
+  TEST_ASSERT_TRUE(buttonsPoll(event));
+  TEST_ASSERT_EQUAL(HAL_BUTTON_PLANT, event.button);
+  TEST_ASSERT_TRUE(event.pressed);
+  TEST_ASSERT_EQUAL(1000, event.atMillis);
+}
+
+static void test_edge_after_poll_time_keeps_bounce_window()
+{
+  pressDuringPoll(1000);
+  ButtonEvent event;
+  TEST_ASSERT_TRUE(buttonsPoll(event));
+
+  // A bounce inside the window is not reported
+  schedulePlant(1002, LOW);
+  halNativeAdvanceMicros(5000);
+  TEST_ASSERT_FALSE(buttonsPoll(event));
+
+  // Once the window is over the release is, stamped at its end
+  halNativeAdvanceMicros(BUTTON_DEBOUNCE_MILLIS * 1000UL);
+  TEST_ASSERT_TRUE(buttonsPoll(event));
+  TEST_ASSERT_FALSE(event.pressed);
+  TEST_ASSERT_EQUAL(1000 + BUTTON_DEBOUNCE_MILLIS, event.atMillis);
+}
+
+static void test_edge_before_poll_time()
+{
+  schedulePlant(1000, HIGH);
+  halNativeAdvanceMicros(1003000);
+
+  ButtonEvent event;
+  TEST_ASSERT_TRUE(buttonsPoll(event));
+  TEST_ASSERT_TRUE(event.pressed);
+  TEST_ASSERT_EQUAL(1000, event.atMillis);
+}
+
+static void test_bounce_window_across_micros_wrap()
+{
+  // micros() wraps 296 us into this millisecond
+  const unsigned long wrapMillis = 4294967;
+  schedulePlant(wrapMillis, HIGH);
+  halNativeAdvanceMicros(wrapMillis * 1000UL + 1000);
+
+  ButtonEvent event;
+  TEST_ASSERT_TRUE(buttonsPoll(event));
+  TEST_ASSERT_TRUE(event.pressed);
+
+  schedulePlant(wrapMillis + 100, LOW);
+  halNativeAdvanceMicros(200000);
+  TEST_ASSERT_TRUE(buttonsPoll(event));
+  TEST_ASSERT_FALSE(event.pressed);
+  TEST_ASSERT_EQUAL(wrapMillis + 100, event.atMillis);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_edge_after_poll_time_is_not_in_the_past);
+  RUN_TEST(test_edge_after_poll_time_keeps_bounce_window);
+  RUN_TEST(test_edge_before_poll_time);
+  RUN_TEST(test_bounce_window_across_micros_wrap);
+  return UNITY_END();
+}
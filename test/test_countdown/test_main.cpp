@@ -0,0 +1,170 @@
+// Unit tests for countdown.h, run with: pio test -e native
+//
+// The millis() clock is an unsigned long, 32 bits on the Mega and 64 bits on
+// the host, so the wrap cases start just below LONG_MAX and ULONG_MAX rather
+// than 2^31 and 2^32: the same edges on the Mega, and still exercised on the
+// host.
+
+#include <limits.h>
+#include <unity.h>
+
+#include "countdown.h"
+
+// Just below the point where the signed difference flips
+static const unsigned long BEFORE_SIGNED_WRAP = (unsigned long)LONG_MAX - 500;
+// Just below the point where the clock itself wraps to 0
+static const unsigned long BEFORE_WRAP = ULONG_MAX - 500;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void assertDeadlineFrom(unsigned long start)
+{
+  Deadline deadline = deadlineAt(start + 1000);
+
+  TEST_ASSERT_EQUAL(1000, deadlineMillisLeft(deadline, start));
+  TEST_ASSERT_FALSE(deadlinePassed(deadline, start));
+  TEST_ASSERT_EQUAL(501, deadlineMillisLeft(deadline, start + 499));
+  TEST_ASSERT_EQUAL(1, deadlineMillisLeft(deadline, start + 999));
+  TEST_ASSERT_FALSE(deadlinePassed(deadline, start + 999));
+  TEST_ASSERT_EQUAL(0, deadlineMillisLeft(deadline, start + 1000));
+  TEST_ASSERT_TRUE(deadlinePassed(deadline, start + 1000));
+}
+
+static void test_deadline_across_signed_wrap()
+{
+  assertDeadlineFrom(BEFORE_SIGNED_WRAP);
+}
+
+static void test_deadline_across_clock_wrap()
+{
+  assertDeadlineFrom(BEFORE_WRAP);
+}
+
+static void test_late_check_is_negative()
+{
+  Deadline deadline = deadlineAt(BEFORE_WRAP + 1000);
+
+  TEST_ASSERT_EQUAL(-1, deadlineMillisLeft(deadline, BEFORE_WRAP + 1001));
+  TEST_ASSERT_EQUAL(-60000, deadlineMillisLeft(deadline, BEFORE_WRAP + 61000));
+  TEST_ASSERT_TRUE(deadlinePassed(deadline, BEFORE_WRAP + 61000));
+}
+
+static void assertClock(const Countdown &countdown, uint16_t secondsLeft, uint8_t minutes, uint8_t seconds)
+{
+  TEST_ASSERT_EQUAL_UINT16(secondsLeft, countdown.secondsLeft);
+  TEST_ASSERT_EQUAL_UINT8(minutes, countdown.minutes);
+  TEST_ASSERT_EQUAL_UINT8(seconds, countdown.seconds);
+}
+
+static void test_start_carries_seconds()
+{
+  Countdown countdown;
+
+  countdownStart(countdown, 1000, 0, 90);
+  assertClock(countdown, 90, 1, 30);
+  TEST_ASSERT_EQUAL(91000, countdown.end.atMillis);
+
+  countdownStart(countdown, 1000, 2, 125);
+  assertClock(countdown, 245, 4, 5);
+
+  countdownStart(countdown, 1000, 0, 255);
+  assertClock(countdown, 255, 4, 15);
+
+  countdownStart(countdown, 1000, 1, 59);
+  assertClock(countdown, 119, 1, 59);
+}
+
+static void test_update_on_time()
+{
+  Countdown countdown;
+  countdownStart(countdown, 1000, 1, 0);
+
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 1000));
+  assertClock(countdown, 60, 1, 0);
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 1001));
+  assertClock(countdown, 59, 0, 59);
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 2000));
+  assertClock(countdown, 59, 0, 59);
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 2001));
+  assertClock(countdown, 58, 0, 58);
+}
+
+static void test_update_catches_up_late_tick()
+{
+  Countdown countdown;
+  countdownStart(countdown, 1000, 1, 0);
+  countdownUpdate(countdown, 1001);
+
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 6500));
+  assertClock(countdown, 54, 0, 54);
+}
+
+static void test_update_catches_up_skipped_ticks_across_minutes()
+{
+  Countdown countdown;
+  countdownStart(countdown, 1000, 3, 0);
+
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 1000 + 61500));
+  assertClock(countdown, 118, 1, 58);
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 1000 + 120500));
+  assertClock(countdown, 59, 0, 59);
+}
+
+static void test_update_ends_and_stays_at_zero()
+{
+  Countdown countdown;
+  countdownStart(countdown, 1000, 1, 0);
+
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, 1000 + 59000));
+  assertClock(countdown, 1, 0, 1);
+  TEST_ASSERT_FALSE(countdownUpdate(countdown, 1000 + 59001));
+  assertClock(countdown, 0, 0, 0);
+  TEST_ASSERT_FALSE(countdownUpdate(countdown, 1000 + 600000));
+  assertClock(countdown, 0, 0, 0);
+}
+
+static void test_update_across_clock_wrap()
+{
+  Countdown countdown;
+  countdownStart(countdown, BEFORE_WRAP, 0, 10);
+
+  TEST_ASSERT_TRUE(countdownUpdate(countdown, BEFORE_WRAP + 5500));
+  assertClock(countdown, 4, 0, 4);
+  TEST_ASSERT_FALSE(countdownUpdate(countdown, BEFORE_WRAP + 10000));
+  assertClock(countdown, 0, 0, 0);
+  TEST_ASSERT_TRUE(deadlinePassed(countdown.end, BEFORE_WRAP + 10000));
+}
+
+static void test_urgency_boundaries()
+{
+  TEST_ASSERT_EQUAL(3000, countdownUrgencyMillis(600));
+  TEST_ASSERT_EQUAL(3000, countdownUrgencyMillis(31));
+  TEST_ASSERT_EQUAL(1000, countdownUrgencyMillis(30));
+  TEST_ASSERT_EQUAL(1000, countdownUrgencyMillis(15));
+  TEST_ASSERT_EQUAL(500, countdownUrgencyMillis(14));
+  TEST_ASSERT_EQUAL(500, countdownUrgencyMillis(6));
+  TEST_ASSERT_EQUAL(250, countdownUrgencyMillis(5));
+  TEST_ASSERT_EQUAL(250, countdownUrgencyMillis(0));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_deadline_across_signed_wrap);
+  RUN_TEST(test_deadline_across_clock_wrap);
+  RUN_TEST(test_late_check_is_negative);
+  RUN_TEST(test_start_carries_seconds);
+  RUN_TEST(test_update_on_time);
+  RUN_TEST(test_update_catches_up_late_tick);
+  RUN_TEST(test_update_catches_up_skipped_ticks_across_minutes);
+  RUN_TEST(test_update_ends_and_stays_at_zero);
+  RUN_TEST(test_update_across_clock_wrap);
+  RUN_TEST(test_urgency_boundaries);
+  return UNITY_END();
+}
@@ -0,0 +1,62 @@
+// Unit tests for scheduler.h on the virtual clock, run with: pio test -e native
+//
+// The sketch's own timers are created by global initializers before these
+// run, so the tests only count on the pool filling up, not on where.
+
+#include <unity.h>
+
+#include "scheduler.h"
+#include "halNative.h"
+
+static unsigned long calls;
+
+static void count()
+{
+  calls++;
+}
+
+void setUp()
+{
+  halNativeInit();
+  calls = 0;
+}
+
+void tearDown()
+{
+}
+
+static void test_create_past_capacity_is_refused()
+{
+  SchedulerTimer last = SCHEDULER_INVALID;
+  SchedulerTimer timer;
+  uint8_t created = 0;
+  while ((timer = schedulerCreate(count, 100)) != SCHEDULER_INVALID)
+  {
+    last = timer;
+    created++;
+    TEST_ASSERT_TRUE(created <= SCHEDULER_CAPACITY);
+  }
+  TEST_ASSERT_TRUE(schedulerRefused() > 0);
+
+  // The refused handle is ignored, the last one created still works
+  schedulerStart(SCHEDULER_INVALID);
+  schedulerSetInterval(SCHEDULER_INVALID, 10);
+  TEST_ASSERT_FALSE(schedulerRunning(SCHEDULER_INVALID));
+  schedulerStop(SCHEDULER_INVALID);
+
+  TEST_ASSERT_TRUE(last != SCHEDULER_INVALID);
+  schedulerStart(last);
+  TEST_ASSERT_TRUE(schedulerRunning(last));
+  halNativeAdvanceMicros(100000);
+  schedulerUpdate();
+  TEST_ASSERT_EQUAL(1, calls);
+  schedulerStop(last);
+  TEST_ASSERT_FALSE(schedulerRunning(last));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_create_past_capacity_is_refused);
+  return UNITY_END();
+}
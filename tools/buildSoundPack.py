@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+"""Builds sounds.pak, the single file the bomb plays its clips from.
+
+Every clip listed in the manifest (sounds/pack.txt) is mixed down to mono,
+resampled to the audio engine rate, levelled to a common loudness and
+stored as unsigned 8 bit PCM, starting on a 512 byte sector boundary.
+Levelling uses the whole 8 bit range for every clip; the manifest gain,
+applied at playback, then sets how loud each clip is relative to the others.
+A manifest line may end with a trim level in dB: the parts before and after
+the clip gets that loud are cut, which is how the key click is made to fit
+the RAM cache.
+Sector 0 holds the index:
+
+    offset  size  field
+    0       4     magic "BSPK"
+    4       2     version, 1
+    6       2     clip count, must match SOUND_COUNT
+    8       4     sample rate in Hz
+    12      4     reserved
+    16      16*n  one entry per clip, in SoundId order:
+                    uint32 first sector, from the start of the pack
+                    uint32 length in samples
+                    uint8  default gain, 128 is unity (Q1.7)
+                    7 bytes reserved
+
+All numbers are little endian. Copy the pack to the root of the SD card.
+
+The clips in CACHED_SOUNDS (src/sounds.cpp) are checked against
+SOUND_CACHE_BYTES (src/config.h) the way src/soundCache.cpp loads them, and
+the build fails when one of them would never be cached.
+
+Usage: buildSoundPack.py <manifest> <output> [--rate HZ] [--level DBFS]
+                         [--cache-bytes N]
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+import wave
+
+MAGIC = b"BSPK"
+VERSION = 1
+SECTOR_BYTES = 512
+HEADER_BYTES = 16
+ENTRY_BYTES = 16
+SILENCE = 0x80
+
+# F_CPU / 1024, one sample per Timer5 period, see src/audioEngine.h
+DEFAULT_RATE = 15625
+# RMS of the audible part of every clip after levelling, in dB full scale
+DEFAULT_LEVEL = -6.0
+# Samples quieter than this do not count towards a clip's loudness
+AUDIBLE = 0.02
+# Peaks above this are compressed rather than clipped
+KNEE = 0.5
+# Samples faded in and out where a clip is trimmed, 2 ms
+TRIM_FADE = 32
+# Samples this close to SILENCE count as silence in src/soundCache.cpp
+CACHE_SILENCE_THRESHOLD = 2
+
+
+def read_sound_ids(header_path):
+    """The SoundId names in enum order, so the manifest cannot drift."""
+    with open(header_path) as header:
+        text = header.read()
+    body = re.search(r"enum SoundId\s*\{(.*?)\}", text, re.S).group(1)
+    names = re.findall(r"\b(SOUND_\w+)\b", body)
+    return [name for name in names if name != "SOUND_COUNT"]
+
+
+def read_manifest(path):
+    clips = []
+    with open(path) as manifest:
+        for number, line in enumerate(manifest, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            fields = line.split()
+            if len(fields) not in (3, 4):
+                sys.exit("%s:%d: expected <SoundId> <file> <gain dB> [<trim dB>]" % (path, number))
+            trim = float(fields[3]) if len(fields) == 4 else None
+            clips.append((fields[0], fields[1], float(fields[2]), trim))
+    return clips
+
+
+def read_cached_sounds(sounds_path):
+    """The SoundId names in CACHED_SOUNDS, in load order."""
+    with open(sounds_path) as source:
+        text = source.read()
+    body = re.search(r"CACHED_SOUNDS\[\w*\]\s*PROGMEM\s*=\s*\{(.*?)\}", text, re.S).group(1)
+    body = re.sub(r"//[^\n]*", "", body)
+    return re.findall(r"\b(SOUND_\w+)\b", body)
+
+
+def read_cache_bytes(config_path):
+    with open(config_path) as config:
+        return int(re.search(r"#define\s+SOUND_CACHE_BYTES\s+(\d+)", config.read()).group(1))
+
+
+def read_samples(path):
+    """Mono samples as floats in [-1, 1], and the source sample rate."""
+    with wave.open(path) as source:
+        channels = source.getnchannels()
+        width = source.getsampwidth()
+        rate = source.getframerate()
+        frames = source.readframes(source.getnframes())
+
+    if width == 1:
+        values = [(byte - 128) / 128.0 for byte in frames]
+    elif width == 2:
+        count = len(frames) // 2
+        values = [value / 32768.0 for value in struct.unpack("<%dh" % count, frames[: count * 2])]
+    else:
+        sys.exit("%s: %d bit samples are not supported" % (path, width * 8))
+
+    if channels > 1:
+        values = [sum(values[i : i + channels]) / channels for i in range(0, len(values) - channels + 1, channels)]
+    return values, rate
+
+
+def resample(values, source_rate, rate):
+    """Linear interpolation, good enough for 8 bit sound effects."""
+    if source_rate == rate or not values:
+        return values
+    count = int(len(values) * rate / source_rate)
+    step = source_rate / rate
+    result = []
+    for i in range(count):
+        position = i * step
+        index = int(position)
+        fraction = position - index
+        after = values[index + 1] if index + 1 < len(values) else values[index]
+        result.append(values[index] + (after - values[index]) * fraction)
+    return result
+
+
+def level(values, decibels):
+    """Brings the audible part of the clip to the target RMS and soft limits
+    the peaks that pushes past the knee."""
+    audible = [value for value in values if abs(value) > AUDIBLE]
+    if not audible:
+        return values
+    rms = math.sqrt(sum(value * value for value in audible) / len(audible))
+    gain = math.pow(10, decibels / 20.0) / rms
+
+    def limit(value):
+        value *= gain
+        magnitude = abs(value)
+        if magnitude <= KNEE:
+            return value
+        magnitude = KNEE + (1 - KNEE) * math.tanh((magnitude - KNEE) / (1 - KNEE))
+        return math.copysign(magnitude, value)
+
+    return [limit(value) for value in values]
+
+
+def trim(values, decibels):
+    """Cuts the clip down to where it is louder than the given level, fading
+    the new ends so the cut does not click."""
+    threshold = math.pow(10, decibels / 20.0)
+    loud = [index for index, value in enumerate(values) if abs(value) > threshold]
+    if not loud:
+        return values
+    values = values[loud[0] : loud[-1] + 1]
+    fade = min(TRIM_FADE, len(values) // 2)
+    for i in range(fade):
+        values[i] *= i / fade
+        values[-1 - i] *= i / fade
+    return values
+
+
+def audible_bytes(pcm):
+    """Length of the clip once the cache has trimmed its silent ends."""
+    loud = [index for index, sample in enumerate(pcm) if abs(sample - SILENCE) > CACHE_SILENCE_THRESHOLD]
+    return loud[-1] - loud[0] + 1 if loud else 0
+
+
+def check_cache(cached, lengths, cache_bytes):
+    """Walks CACHED_SOUNDS like soundCacheBegin() and fails on a clip that
+    cannot be loaded, so a dead cache entry does not go unnoticed."""
+    used = 0
+    for name in cached:
+        length = lengths[name]
+        if length > cache_bytes - used:
+            sys.exit(
+                "%s is in CACHED_SOUNDS but needs %d bytes, only %d of SOUND_CACHE_BYTES %d are left"
+                % (name, length, cache_bytes - used, cache_bytes)
+            )
+        used += length
+    print("sound cache: %d of %d bytes used" % (used, cache_bytes))
+
+
+def to_pcm8(values):
+    return bytes(max(0, min(255, int(round(value * 127)) + 128)) for value in values)
+
+
+def gain_q7(decibels):
+    return max(1, min(255, int(round(128 * math.pow(10, decibels / 20.0)))))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("manifest")
+    parser.add_argument("output")
+    parser.add_argument("--rate", type=int, default=DEFAULT_RATE)
+    parser.add_argument("--level", type=float, default=DEFAULT_LEVEL, help="loudness after levelling, dB full scale")
+    parser.add_argument("--ids", help="header declaring SoundId, default src/sounds.h")
+    parser.add_argument("--cache-bytes", type=int, help="SOUND_CACHE_BYTES of the firmware, default from src/config.h")
+    args = parser.parse_args()
+
+    sound_dir = os.path.dirname(os.path.abspath(args.manifest))
+    src_dir = os.path.join(sound_dir, os.pardir, "src")
+    ids_path = args.ids or os.path.join(src_dir, "sounds.h")
+    clips = read_manifest(args.manifest)
+
+    expected = read_sound_ids(ids_path)
+    listed = [clip[0] for clip in clips]
+    if listed != expected:
+        sys.exit("manifest must list %s in this order:\n  %s" % (ids_path, "\n  ".join(expected)))
+    if HEADER_BYTES + ENTRY_BYTES * len(clips) > SECTOR_BYTES:
+        sys.exit("too many clips for a one sector index")
+
+    entries = []
+    data = bytearray()
+    lengths = {}
+    for name, file_name, decibels, trim_decibels in clips:
+        values, source_rate = read_samples(os.path.join(sound_dir, file_name))
+        values = level(resample(values, source_rate, args.rate), args.level)
+        if trim_decibels is not None:
+            values = trim(values, trim_decibels)
+        pcm = to_pcm8(values)
+        lengths[name] = audible_bytes(pcm)
+        first_sector = 1 + len(data) // SECTOR_BYTES
+        entries.append(struct.pack("<IIB7x", first_sector, len(pcm), gain_q7(decibels)))
+        data += pcm
+        data += bytes([SILENCE]) * (-len(data) % SECTOR_BYTES)
+        print("%-20s %-24s %7d samples  gain %3d" % (name, file_name, len(pcm), gain_q7(decibels)))
+
+    cache_bytes = args.cache_bytes or read_cache_bytes(os.path.join(src_dir, "config.h"))
+    check_cache(read_cached_sounds(os.path.join(src_dir, "sounds.cpp")), lengths, cache_bytes)
+
+    header = MAGIC + struct.pack("<HHII", VERSION, len(clips), args.rate, 0) + b"".join(entries)
+    header += bytes(SECTOR_BYTES - len(header))
+
+    with open(args.output, "wb") as output:
+        output.write(header)
+        output.write(data)
+    print("%s: %d bytes" % (args.output, len(header) + len(data)))
+
+
+if __name__ == "__main__":
+    main()
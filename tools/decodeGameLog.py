@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Turns events.log, the bomb's game event log, into CSV.
+
+The log is a sequence of 8 byte records, little endian, see src/gameLog.h:
+
+    offset  size  field
+    0       4     millis() when it happened
+    4       1     event, GameLogEvent in src/gameLog.h
+    5       1     round number since boot
+    6       2     value
+
+It ends at the first record whose event is GAME_LOG_EMPTY. Each output row
+gets the boot it belongs to, counted from the start of the log, and for the
+end of a planting or defusing attempt how long the attempt lasted.
+
+Usage: decodeGameLog.py <events.log> [output.csv]
+"""
+
+import argparse
+import csv
+import os
+import re
+import struct
+import sys
+
+RECORD = struct.Struct("<IBBH")
+
+# The attempt each event closes, so its duration can be worked out
+ATTEMPT_STARTS = {
+    "PLANTING_CANCELLED": "PLANTING",
+    "PLANTED": "PLANTING",
+    "DEFUSING_CANCELLED": "DEFUSING",
+    "DEFUSED": "DEFUSING",
+}
+
+
+def read_event_names(header_path):
+    """The GameLogEvent names in enum order, so the decoder cannot drift."""
+    with open(header_path) as header:
+        text = header.read()
+    body = re.search(r"enum GameLogEvent\s*\{(.*?)\}", text, re.S).group(1)
+    body = re.sub(r"//.*", "", body)
+    return [name[len("GAME_LOG_"):] for name in re.findall(r"\b(GAME_LOG_\w+)\b", body)]
+
+
+def decode(data, names):
+    boot = 0
+    started = {}
+    for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+        millis, event, round_number, value = RECORD.unpack_from(data, offset)
+        name = names[event] if event < len(names) else "UNKNOWN_%d" % event
+        if name == "EMPTY":
+            break
+
+        if name == "BOOT":
+            boot += 1
+            started = {}
+        elif name in ("PLANTING", "DEFUSING"):
+            started[name] = millis
+
+        duration = ""
+        start = ATTEMPT_STARTS.get(name)
+        if start in started:
+            duration = millis - started.pop(start)
+
+        yield [boot, round_number, millis, name, value, duration]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("log")
+    parser.add_argument("output", nargs="?")
+    args = parser.parse_args()
+
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    names = read_event_names(os.path.join(root, "src", "gameLog.h"))
+
+    with open(args.log, "rb") as log:
+        data = log.read()
+
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    try:
+        writer = csv.writer(output)
+        writer.writerow(["boot", "round", "millis", "event", "value", "duration_ms"])
+        writer.writerows(decode(data, names))
+    finally:
+        if args.output:
+            output.close()
+
+
+if __name__ == "__main__":
+    main()
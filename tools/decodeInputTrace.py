@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Turns inputs.trc, the bomb's keypad and button trace, into CSV.
+
+The trace is a sequence of 512 byte sectors holding records that never
+span two sectors, see src/inputTrace.h. A zero byte where a record would
+start ends the sector, and an empty sector ends the trace. Each record
+starts with a head byte, kind << 4 | detail:
+
+    boot    0x10, uint32 millis() little endian
+    key     0x20 | KeyEventType, varint millis since the previous record,
+            varint age, key, held key (chords only)
+    button  0x30 | button << 1 | pressed, varint millis since the
+            previous record, varint age
+
+Varints take 7 bits per byte, low bits first. Boots are counted from 0, the
+number to pass to --replay on the native build. The event time is the
+millis() the game used, the consumed time minus the age.
+
+Usage: decodeInputTrace.py <inputs.trc> [output.csv]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+SECTOR_BYTES = 512
+KEY_EVENTS = ["PRESS", "RELEASE", "LONG_PRESS", "CHORD"]
+BUTTONS = ["PLANT", "DEFUSE"]
+
+
+def read_varint(sector, offset):
+    value = 0
+    for length in range(5):
+        byte = sector[offset + length]
+        value |= (byte & 0x7F) << (7 * length)
+        if not byte & 0x80:
+            return value, offset + length + 1
+    raise ValueError("varint too long")
+
+
+def decode(data):
+    boot = -1
+    last = 0
+    for start in range(0, len(data) - SECTOR_BYTES + 1, SECTOR_BYTES):
+        sector = data[start:start + SECTOR_BYTES]
+        offset = 0
+        if sector[0] == 0:
+            return
+
+        while offset < SECTOR_BYTES and sector[offset] != 0:
+            head = sector[offset]
+            kind = head & 0xF0
+            if kind == 0x10:
+                boot += 1
+                last = struct.unpack_from("<I", sector, offset + 1)[0]
+                offset += 5
+                yield [boot, last, last, "BOOT", "", "", ""]
+                continue
+
+            delta, offset = read_varint(sector, offset + 1)
+            age, offset = read_varint(sector, offset)
+            last = (last + delta) & 0xFFFFFFFF
+            if kind == 0x20:
+                event = KEY_EVENTS[head & 0x0F]
+                key = chr(sector[offset])
+                offset += 1
+                held = ""
+                if event == "CHORD":
+                    held = chr(sector[offset])
+                    offset += 1
+                yield [boot, last, last - age, "KEY_" + event, key, held, ""]
+            elif kind == 0x30:
+                button = BUTTONS[(head >> 1) & 0x07]
+                state = "PRESSED" if head & 1 else "RELEASED"
+                yield [boot, last, last - age, "BUTTON", "", "", button + " " + state]
+            else:
+                raise ValueError("bad record head 0x%02x at %d" % (head, start + offset))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("trace")
+    parser.add_argument("output", nargs="?")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as trace:
+        data = trace.read()
+
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    try:
+        writer = csv.writer(output)
+        writer.writerow(["boot", "consumed_millis", "event_millis", "event", "key", "held_key", "button"])
+        writer.writerows(decode(data))
+    finally:
+        if args.output:
+            output.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,21 @@
+# PlatformIO extra script: `pio run -e nanoatmega328 -t soundpack` builds the
+# SD card sound pack from sounds/pack.txt, see tools/buildSoundPack.py
+Import("env")
+
+# Check the cached clips against the SOUND_CACHE_BYTES this environment is
+# built with, when build_flags override the one in src/config.h
+cache_bytes = ""
+for define in env.get("CPPDEFINES", []):
+    if isinstance(define, (list, tuple)) and define[0] == "SOUND_CACHE_BYTES":
+        cache_bytes = " --cache-bytes %s" % define[1]
+
+env.AddCustomTarget(
+    name="soundpack",
+    dependencies=None,
+    actions=[
+        '"$PYTHONEXE" "$PROJECT_DIR/tools/buildSoundPack.py" "$PROJECT_DIR/sounds/pack.txt" "$BUILD_DIR/sounds.pak"'
+        + cache_bytes
+    ],
+    title="Sound pack",
+    description="Convert sounds/ into sounds.pak for the SD card",
+)
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Decodes the bomb's telemetry frames and shows them as they arrive.
+
+Frames are COBS encoded between zero bytes and end with a CRC-16/CCITT of
+their payload, see src/telemetry.h. Status frames become one line each;
+log frames (src/log.h) are formatted with the text of their message ID,
+taken from src/logMessages.def. Whatever arrives between frames is
+DEBUG text and is passed through unless --quiet is given. The source is a
+serial port (needs pyserial), a capture file, or - for stdin.
+
+Usage: telemetryViewer.py <port|file|-> [--baud 115200] [--quiet]
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+STATUS = 1
+LOG = 2
+STATUS_LAYOUT = struct.Struct("<BBIBBHBHH")
+LOG_HEADER = struct.Struct("<BBBI")
+LEVELS = ["OFF", "ERROR", "WARN", "INFO", "DEBUG"]
+
+
+def read_enum(header_path, enum):
+    """The names of an enum in src/main.h, in order."""
+    with open(header_path) as header:
+        text = header.read()
+    body = re.search(r"enum %s\s*\{(.*?)\}" % enum, text, re.S).group(1)
+    body = re.sub(r"//.*", "", body)
+    return re.findall(r"\b(\w+)\b", body)
+
+
+def read_log_messages(def_path):
+    """The log formats in ID order, as the firmware numbers them."""
+    with open(def_path) as table:
+        text = table.read()
+    text = re.sub(r"//.*", "", text)
+    return [format for _, format in re.findall(r'LOG_MESSAGE\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', text)]
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """The decoded bytes, or None when data is not valid COBS."""
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            return None
+        out += data[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frame(chunk):
+    """The payload of a frame, or None when chunk is not one."""
+    data = cobs_decode(chunk)
+    if data is None or len(data) < 3:
+        return None
+    payload, crc = data[:-2], data[-2:]
+    if crc16(payload) != (crc[0] << 8 | crc[1]):
+        return None
+    return payload
+
+
+def describe_log(payload, messages):
+    _, level, message, millis = LOG_HEADER.unpack_from(payload)
+    arguments = struct.unpack_from("<%di" % ((len(payload) - LOG_HEADER.size) // 4), payload, LOG_HEADER.size)
+    if message < len(messages):
+        try:
+            text = messages[message] % arguments
+        except (TypeError, ValueError):
+            text = "%s %r" % (messages[message], arguments)
+    else:
+        text = "unknown message %d %r" % (message, arguments)
+    return "%9.3f s  %-5s  %s" % (millis / 1000.0, LEVELS[level] if level < len(LEVELS) else level, text)
+
+
+def describe(payload, runlevels, menus, last_sequence):
+    if payload[0] != STATUS or len(payload) != STATUS_LAYOUT.size:
+        return "unknown frame type %d" % payload[0], last_sequence
+
+    (_, sequence, millis, runlevel, menu, seconds_left, buttons, free_memory,
+     dropped) = STATUS_LAYOUT.unpack(payload)
+    missed = ""
+    if last_sequence is not None and (last_sequence + 1) & 0xFF != sequence:
+        missed = "  (%d missed)" % ((sequence - last_sequence - 1) & 0xFF)
+
+    line = "%9.3f s  %-9s %-15s left %4d s  plant %s  defuse %s  free %5d  dropped %d%s" % (
+        millis / 1000.0,
+        runlevels[runlevel] if runlevel < len(runlevels) else runlevel,
+        menus[menu] if menu < len(menus) else menu,
+        seconds_left,
+        "X" if buttons & 1 else "-",
+        "X" if buttons & 2 else "-",
+        free_memory,
+        dropped,
+        missed,
+    )
+    return line, sequence
+
+
+def open_source(name, baud):
+    if name == "-":
+        return sys.stdin.buffer
+    if os.path.isfile(name):
+        return open(name, "rb")
+    import serial  # only needed for a live port
+    return serial.Serial(name, baud, timeout=0.1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("source")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--quiet", action="store_true", help="hide the text between frames")
+    args = parser.parse_args()
+
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    runlevels = read_enum(os.path.join(root, "src", "main.h"), "Runtime")
+    menus = read_enum(os.path.join(root, "src", "main.h"), "MenuLevel")
+    messages = read_log_messages(os.path.join(root, "src", "logMessages.def"))
+
+    source = open_source(args.source, args.baud)
+    pending = bytearray()
+    last_sequence = None
+    while True:
+        data = source.read(256)
+        if not data:
+            if hasattr(source, "in_waiting"):
+                continue  # serial timeout, keep listening
+            break
+        pending += data
+
+        while 0 in pending:
+            end = pending.index(0)
+            chunk, pending = bytes(pending[:end]), pending[end + 1:]
+            if not chunk:
+                continue
+            payload = decode_frame(chunk)
+            if payload is not None and payload[0] == LOG and len(payload) >= LOG_HEADER.size:
+                print(describe_log(payload, messages), flush=True)
+            elif payload is not None:
+                line, last_sequence = describe(payload, runlevels, menus, last_sequence)
+                print(line, flush=True)
+            elif not args.quiet:
+                sys.stdout.write(chunk.decode("ascii", "replace"))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()